@@ -0,0 +1,452 @@
+// Google Benchmark suite for the distribution and tree hot paths.
+//
+// Run with JSON output for regression tracking, e.g.
+//   bayes_tree_bench --benchmark_format=json --benchmark_out=bench.json
+// or build the `run_benchmarks` target.
+#include <benchmark/benchmark.h>
+#include "bayes_tree/bayes_tree.hpp"
+#include "bayes_tree/categorical_distribution.hpp"
+#include "bayes_tree/codegen.hpp"
+#include "bayes_tree/dirichlet_distribution.hpp"
+#include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/sparse_conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/tree_sampler.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr unsigned int kSeed = 12345;
+
+// Random counts for K categories with expected total `magnitude`
+std::vector<int> makeCounts(int num_categories, int magnitude, unsigned int seed = kSeed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, std::max(1, 2 * magnitude / num_categories));
+    std::vector<int> counts(num_categories);
+    for (auto& c : counts) c = dist(gen);
+    return counts;
+}
+
+std::vector<double> makeAlphas(int num_categories, unsigned int seed = kSeed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(0.5, 5.0);
+    std::vector<double> alphas(num_categories);
+    for (auto& a : alphas) a = dist(gen);
+    return alphas;
+}
+
+// Synthetic classification data: num_classes classes, label driven by the
+// first two features plus label noise, remaining features are noise
+void makeTreeData(int n, int num_features, int num_classes,
+                  BayesTree::FeatureMatrix& X, std::vector<int>& y, unsigned int seed = kSeed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    X.assign(n, std::vector<double>(num_features));
+    y.resize(n);
+    for (int i = 0; i < n; ++i) {
+        for (auto& v : X[i]) v = u(gen);
+        int label = static_cast<int>((X[i][0] + X[i][1]) * 0.5 * num_classes);
+        if (u(gen) < 0.1) label = static_cast<int>(u(gen) * num_classes);
+        y[i] = std::min(label, num_classes - 1);
+    }
+}
+
+}  // namespace
+
+// ======== DirichletDistribution ========
+
+static void BM_DirichletSample(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    DirichletDistribution d(makeAlphas(k), kSeed);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(d.sample());
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_DirichletSample)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_DirichletLogPdf(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    DirichletDistribution d(makeAlphas(k), kSeed);
+    const auto x = d.mean();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(d.logPdf(x));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_DirichletLogPdf)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_DirichletSetAlpha(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    DirichletDistribution d(makeAlphas(k), kSeed);
+    const auto alphas = makeAlphas(k, kSeed + 1);
+    for (auto _ : state) {
+        d.setAlpha(alphas);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_DirichletSetAlpha)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_DirichletSetAlphaUnchecked(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    DirichletDistribution d(makeAlphas(k), kSeed);
+    const auto alphas = makeAlphas(k, kSeed + 1);
+    for (auto _ : state) {
+        d.setAlphaUnchecked(alphas);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_DirichletSetAlphaUnchecked)->RangeMultiplier(10)->Range(2, 1000);
+
+// ======== CategoricalDistribution ========
+
+static void BM_CategoricalLogLikelihood(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    CategoricalDistribution dist(makeAlphas(k));
+    const auto counts = makeCounts(k, 100 * k);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dist.log_likelihood(counts));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_CategoricalLogLikelihood)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_CategoricalLogLikelihoodUnchecked(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    CategoricalDistribution dist(makeAlphas(k));
+    const auto counts = makeCounts(k, 100 * k);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dist.log_likelihood_unchecked(counts));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_CategoricalLogLikelihoodUnchecked)->RangeMultiplier(10)->Range(2, 1000);
+
+// ======== ConjugateCategoricalDirichlet ========
+
+static void BM_ConjugateInitialise(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    ConjugateCategoricalDirichlet cd(k);
+    for (auto _ : state) {
+        cd.initialise(k);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_ConjugateInitialise)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_PosteriorUpdate(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    ConjugateCategoricalDirichlet cd(k);
+    const auto counts = makeCounts(k, 10 * k);
+    for (auto _ : state) {
+        cd.updateFromObservations(counts);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_PosteriorUpdate)->RangeMultiplier(10)->Range(2, 1000);
+
+static void BM_PosteriorUpdateUnchecked(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    ConjugateCategoricalDirichlet cd(k);
+    const auto counts = makeCounts(k, 10 * k);
+    for (auto _ : state) {
+        cd.updateFromObservationsUnchecked(counts);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_PosteriorUpdateUnchecked)->RangeMultiplier(10)->Range(2, 1000);
+
+// Marginal likelihood across K (arg 0) and total count magnitude (arg 1)
+static void BM_MarginalLikelihood(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    const int magnitude = static_cast<int>(state.range(1));
+    ConjugateCategoricalDirichlet cd(k);
+    const auto counts = makeCounts(k, magnitude);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cd.getLogLikelihoodFromObservations(counts));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_MarginalLikelihood)
+    ->ArgsProduct({{2, 10, 100, 1000}, {10, 1000, 100000}})
+    ->ArgNames({"K", "N"});
+
+// Same grid with a non-lattice prior (alpha = 0.7): always the libm path.
+// Compare with BM_MarginalLikelihood (Jeffreys, table-driven).
+static void BM_MarginalLikelihoodGeneric(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    const int magnitude = static_cast<int>(state.range(1));
+    ConjugateCategoricalDirichlet cd(k, 0.7);
+    const auto counts = makeCounts(k, magnitude);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cd.getLogLikelihoodFromObservations(counts));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_MarginalLikelihoodGeneric)
+    ->ArgsProduct({{2, 10, 100, 1000}, {10, 1000, 100000}})
+    ->ArgNames({"K", "N"});
+
+static void BM_MarginalLikelihoodUnchecked(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    const int magnitude = static_cast<int>(state.range(1));
+    ConjugateCategoricalDirichlet cd(k);
+    const auto counts = makeCounts(k, magnitude);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cd.getLogLikelihoodFromObservationsUnchecked(counts));
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+}
+BENCHMARK(BM_MarginalLikelihoodUnchecked)
+    ->ArgsProduct({{2, 10, 100, 1000}, {10, 1000, 100000}})
+    ->ArgNames({"K", "N"});
+
+// High-cardinality targets: K categories (arg 0), 8 observed per call
+static SparseCounts makeSparseCounts(int num_categories, int nnz, unsigned int seed = kSeed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> index(0, num_categories - 1);
+    std::vector<int> dense_indices;
+    for (int i = 0; i < nnz; ++i) dense_indices.push_back(index(gen));
+    std::sort(dense_indices.begin(), dense_indices.end());
+    dense_indices.erase(std::unique(dense_indices.begin(), dense_indices.end()), dense_indices.end());
+    SparseCounts counts;
+    for (int i : dense_indices) counts.push_back({i, 1 + i % 5});
+    return counts;
+}
+
+static void BM_SparseMarginalLikelihood(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    SparseConjugateCategoricalDirichlet cd(k);
+    cd.updateFromObservations(makeSparseCounts(k, 64, kSeed + 1));
+    const auto counts = makeSparseCounts(k, 8);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cd.getLogLikelihoodFromObservations(counts));
+    }
+}
+BENCHMARK(BM_SparseMarginalLikelihood)->RangeMultiplier(10)->Range(1000, 100000);
+
+static void BM_DenseMarginalLikelihoodOfSparseCounts(benchmark::State& state) {
+    const int k = static_cast<int>(state.range(0));
+    ConjugateCategoricalDirichlet cd(k);
+    cd.updateFromObservations(toDenseCounts(makeSparseCounts(k, 64, kSeed + 1), k));
+    const auto counts = toDenseCounts(makeSparseCounts(k, 8), k);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cd.getLogLikelihoodFromObservations(counts));
+    }
+}
+BENCHMARK(BM_DenseMarginalLikelihoodOfSparseCounts)->RangeMultiplier(10)->Range(1000, 100000);
+
+// ======== BayesTree ========
+
+// Tree fit on synthetic data: rows (arg 0), features (arg 1), threads (arg 2)
+static void BM_TreeFit(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), 4, X, y);
+
+    BayesTreeParams params;
+    params.num_threads = static_cast<int>(state.range(2));
+    params.hierarchical_prior = state.range(3) != 0;
+    for (auto _ : state) {
+        BayesTree tree(params);
+        tree.fit(X, y);
+        benchmark::DoNotOptimize(tree.getNumNodes());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TreeFit)
+    ->ArgsProduct({{1000, 10000}, {8}, {1, 4}, {0, 1}})
+    ->ArgNames({"rows", "features", "threads", "hierarchical"})
+    ->Unit(benchmark::kMillisecond);
+
+// Split search with and without upper-bound pruning; both build the same tree
+static void BM_TreeFitPruning(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), 4, X, y);
+
+    BayesTreeParams params;
+    params.max_bins = 256;
+    params.prune_splits = state.range(2) != 0;
+    TrainingReport report;
+    for (auto _ : state) {
+        BayesTree tree(params);
+        tree.fit(X, y);
+        report = tree.getTrainingReport();
+        benchmark::DoNotOptimize(tree.getNumNodes());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    const double candidates = static_cast<double>(report.candidate_splits_scored + report.candidate_splits_pruned);
+    state.counters["pruned_fraction"] = candidates > 0 ? report.candidate_splits_pruned / candidates : 0.0;
+    state.counters["features_pruned"] = static_cast<double>(report.features_pruned);
+}
+BENCHMARK(BM_TreeFitPruning)
+    ->ArgsProduct({{10000}, {8, 32}, {0, 1}})
+    ->ArgNames({"rows", "features", "prune"})
+    ->Unit(benchmark::kMillisecond);
+
+// Weighted fit against the same rows repeated by their (integer) weights
+static void BM_TreeFitWeighted(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(static_cast<int>(state.range(0)), 8, 4, X, y);
+    std::vector<double> weights(y.size());
+    for (std::size_t i = 0; i < y.size(); ++i) weights[i] = 1.0 + static_cast<double>(i % 4);
+
+    const bool expand = state.range(1) != 0;
+    BayesTree::FeatureMatrix X_expanded;
+    std::vector<int> y_expanded;
+    if (expand) {
+        for (std::size_t i = 0; i < y.size(); ++i) {
+            for (int w = 0; w < static_cast<int>(weights[i]); ++w) {
+                X_expanded.push_back(X[i]);
+                y_expanded.push_back(y[i]);
+            }
+        }
+    }
+
+    for (auto _ : state) {
+        BayesTree tree;
+        if (expand)
+            tree.fit(X_expanded, y_expanded);
+        else
+            tree.fit(X, y, weights);
+        benchmark::DoNotOptimize(tree.getNumNodes());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TreeFitWeighted)
+    ->ArgsProduct({{10000}, {0, 1}})
+    ->ArgNames({"rows", "expanded"})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_TreePredictProba(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(10000, 8, 4, X, y);
+    BayesTree tree;
+    tree.fit(X, y);
+
+    for (auto _ : state) {
+        for (const auto& row : X) benchmark::DoNotOptimize(tree.predictProba(row));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(X.size()));
+}
+BENCHMARK(BM_TreePredictProba)->Unit(benchmark::kMillisecond);
+
+static void BM_TreePredictClass(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(10000, 8, 4, X, y);
+    BayesTree tree;
+    tree.fit(X, y);
+
+    for (auto _ : state) {
+        for (const auto& row : X) benchmark::DoNotOptimize(tree.predictClass(row));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(X.size()));
+}
+BENCHMARK(BM_TreePredictClass)->Unit(benchmark::kMillisecond);
+
+// ======== Compiled inference ========
+
+// Single-row latency of a depth-6 tree: interpreted flat store (arg 0 = 0),
+// generated nested ifs (1) or generated select walk (2)
+static void BM_CompiledPredict(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(10000, 8, 4, X, y);
+    BayesTreeParams params;
+    params.max_depth = 6;
+    BayesTree tree(params);
+    tree.fit(X, y);
+    const SampledTreeStore store = toSampledTreeStore(tree);
+
+    const int mode = static_cast<int>(state.range(0));
+    std::vector<CompiledModel> model;
+    if (mode > 0) {
+        CodegenParams codegen;
+        codegen.max_branchless_depth = mode == 2 ? 64 : 0;
+        const auto dir = std::filesystem::temp_directory_path();
+        const std::string name = "bayes_tree_bench_model" + std::to_string(mode);
+        const auto source = (dir / (name + ".cpp")).string();
+        const auto library = (dir / (name + ".so")).string();
+        std::ofstream(source) << generateModelSource(tree, codegen);
+        try {
+            compileSharedObject(source, library, BAYES_TREE_CXX_COMPILER);
+            model.emplace_back(library);
+        } catch (const std::exception& e) {
+            state.SkipWithError(e.what());
+            return;
+        }
+    }
+
+    std::vector<double> probs(4);
+    for (auto _ : state) {
+        for (const auto& row : X) {
+            if (mode == 0) {
+                benchmark::DoNotOptimize(store.predictProba(row));
+            } else {
+                model[0].predictProba(row.data(), probs.data());
+                benchmark::DoNotOptimize(probs.data());
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(X.size()));
+}
+BENCHMARK(BM_CompiledPredict)->Arg(0)->Arg(1)->Arg(2)->ArgName("mode")->Unit(benchmark::kMillisecond);
+
+// ======== TreeSampler ========
+
+// MCMC over tree structures: chains (arg 0), threads (arg 1)
+static void BM_TreeSamplerFit(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(5000, 8, 4, X, y);
+
+    TreeSamplerParams params;
+    params.num_chains = static_cast<int>(state.range(0));
+    params.num_threads = static_cast<int>(state.range(1));
+    params.num_iterations = 500;
+    params.burn_in = 100;
+    for (auto _ : state) {
+        TreeSampler sampler(params);
+        sampler.fit(X, y);
+        benchmark::DoNotOptimize(sampler.getSamples().numTrees());
+    }
+    state.SetItemsProcessed(state.iterations() * params.num_chains * params.num_iterations);
+}
+BENCHMARK(BM_TreeSamplerFit)
+    ->ArgsProduct({{4}, {1, 4}})
+    ->ArgNames({"chains", "threads"})
+    ->Unit(benchmark::kMillisecond);
+
+// Sample-store prediction by leaf format (arg 0: LeafFormat) with 16 classes,
+// so leaf decoding dominates the node walk
+static void BM_SampledStorePredict(benchmark::State& state) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeTreeData(2000, 8, 16, X, y);
+
+    TreeSamplerParams params;
+    params.num_chains = 2;
+    params.num_iterations = 400;
+    params.burn_in = 100;
+    params.leaf_format = static_cast<LeafFormat>(state.range(0));
+    TreeSampler sampler(params);
+    sampler.fit(X, y);
+
+    for (auto _ : state) {
+        for (int i = 0; i < 100; ++i) benchmark::DoNotOptimize(sampler.predictProba(X[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * 100);
+    state.counters["bytes"] = static_cast<double>(sampler.getSamples().memoryBytes());
+}
+BENCHMARK(BM_SampledStorePredict)->Arg(0)->Arg(1)->Arg(2)->ArgName("format");
+
+BENCHMARK_MAIN();
@@ -1,7 +1,155 @@
 #pragma once
 
+#include "bayes_tree/binned_data.hpp"
+#include "bayes_tree/node.hpp"
+#include "bayes_tree/profiling.hpp"
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BayesTreeParams {
+    int max_depth = 8;
+    int min_samples_leaf = 1;
+    int max_bins = 64;          // At most 256
+    double prior_alpha = 0.5;   // Symmetric Dirichlet prior; 0.5 is Jeffreys
+    double min_gain = 0.0;      // Minimum log marginal likelihood gain to split
+    int num_threads = 1;        // Nodes of one level are processed in parallel
+
+    // Hierarchical shrinkage: each child's prior is the parent's posterior
+    // mean scaled to prior_concentration total alpha, so small nodes shrink
+    // towards their ancestors instead of towards the flat root prior.
+    // prior_concentration <= 0 uses 0.5 per class, matching
+    // ConjugateCategoricalDirichlet::initialiseJeffreysFromObservationDistribution.
+    bool hierarchical_prior = false;
+    double prior_concentration = 0.0;
+
+    // Columns of X holding integer category codes in [0, 254]. They are
+    // split natively into two category sets instead of one-hot encoded.
+    // NaN marks a missing value in any column.
+    std::vector<int> categorical_features;
+
+    // Skip ranges of candidate cuts whose marginal-likelihood upper bound
+    // cannot beat the best split found so far. Trees are identical with or
+    // without pruning; the training report counts what was skipped.
+    bool prune_splits = true;
+};
+
+// Classification tree whose splits are chosen by Dirichlet-multinomial
+// marginal likelihood and whose nodes carry Dirichlet posteriors.
 class BayesTree {
 public:
+    using FeatureMatrix = BinnedData::FeatureMatrix;  // Row-major
+
     BayesTree();              // constructor declaration
+    explicit BayesTree(const BayesTreeParams& params);
+
+    // Placeholder scalar predictor, kept for backwards compatibility
     double predict(double x) const;
+
+    // Train on rows X with class labels y in [0, num_classes).
+    // num_classes <= 0 infers it from the labels.
+    void fit(const FeatureMatrix& X, const std::vector<int>& y, int num_classes = 0);
+    // Weighted training: row i counts sample_weight[i] times. Weights are
+    // finite and non-negative but need not be integers (bootstrap or
+    // importance weights). Split scores and posteriors use weighted class
+    // counts; min_samples_leaf and Node::counts still count rows.
+    void fit(const FeatureMatrix& X, const std::vector<int>& y,
+             const std::vector<double>& sample_weight, int num_classes = 0);
+
+    // Posterior mean class probabilities of the leaf reached by x
+    std::vector<double> predictProba(const std::vector<double>& x) const;
+    std::vector<std::vector<double>> predictProba(const FeatureMatrix& X) const;
+    int predictClass(const std::vector<double>& x) const;
+
+    // Accessors
+    bool isFitted() const;
+    int getNumClasses() const;
+    int getNumFeatures() const;
+    std::size_t getNumNodes() const;
+    std::size_t getNumLeaves() const;
+    int getDepth() const;
+    const std::vector<Node>& getNodes() const;
+    const BayesTreeParams& getParams() const;
+    const TrainingReport& getTrainingReport() const;
+
+private:
+    using Bin = BinnedData::Bin;
+
+    // A node awaiting processing; its rows are row_index_[begin, end) and its
+    // prior is row prior_row of the level's LevelPriors
+    struct FrontierNode {
+        int node_index;
+        int begin;
+        int end;
+        int prior_row;
+    };
+
+    // Dirichlet priors for the nodes of one level in contiguous rows of K
+    // alphas, with the prior-only terms of the marginal likelihood cached
+    // per row. Filled for a whole level at once; no per-node distribution
+    // objects are built during training.
+    struct LevelPriors {
+        int num_classes = 0;
+        std::vector<double> alphas;         // rows * K
+        std::vector<double> lgamma_alphas;  // rows * K
+        std::vector<double> totals;
+        std::vector<double> lgamma_totals;
+        std::vector<char> lattice;          // Every alpha of the row is a multiple of 1/2
+
+        void resize(std::size_t rows, int K);
+        std::size_t numRows() const;
+        const double* row(std::size_t r) const;
+        // Fill the cached terms of every row from its alphas
+        void computeTerms();
+        double logMarginalLikelihood(std::size_t r, const int* counts) const;
+        double logMarginalLikelihood(std::size_t r, const double* counts) const;
+        // Upper bound on the summed log marginal likelihoods of (left,
+        // total - left) over all left between lo and hi, class by class
+        template <typename Count>
+        double splitUpperBound(std::size_t r, const Count* total, const Count* lo, const Count* hi) const;
+    };
+
+    struct SplitResult {
+        std::vector<double> left_counts;  // Class counts (weights) of the left child
+        bool split = false;
+        int feature = -1;
+        int bin = -1;                  // Numeric: bins <= bin go left
+        bool categorical = false;
+        bool missing_left = false;
+        std::bitset<256> left_bins;    // Categorical: codes going left
+        double gain = 0.0;
+        int split_point = 0;  // Rows [begin, split_point) went left
+        std::uint64_t bytes_touched = 0;
+    };
+
+    // Count is int for unweighted training and double for weighted
+    // training, where sample_weight is non-null
+    template <typename Count>
+    void train(const FeatureMatrix& X, const std::vector<int>& y, const double* sample_weight,
+               int num_classes);
+    template <typename Count>
+    SplitResult processNode(const FrontierNode& frontier, int depth, const std::vector<int>& y,
+                            const double* sample_weight, const Count* counts,
+                            const LevelPriors& priors, const LevelPriors& child_priors,
+                            std::size_t child_row, ThreadReport& thread_report);
+    template <typename Count>
+    void deriveChildPriors(const std::vector<FrontierNode>& frontier, const std::vector<Count>& counts,
+                           const LevelPriors& priors, LevelPriors& child_priors) const;
+    int partitionRows(int begin, int end, int feature, const std::array<std::uint8_t, 256>& goes_left);
+    const Node& findLeaf(const std::vector<double>& x) const;
+
+    BayesTreeParams params_;
+    int num_classes_ = 0;
+    int num_features_ = 0;
+    int num_rows_ = 0;
+
+    // Training-time state
+    BinnedData binned_;
+    std::vector<int> row_index_;                  // Rows grouped by frontier node
+    std::vector<int> row_scratch_;                // Partition buffer, same size as row_index_
+
+    std::vector<Node> nodes_;
+    TrainingReport report_;
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Feature matrix quantile-binned into at most 256 bins per feature, stored
+// column-major. Bin b of feature f holds values x with
+// edges(f)[b-1] < x <= edges(f)[b], so "bin <= b" is "x <= threshold(f, b)".
+//
+// NaN marks a missing value. Columns with missing values get one extra
+// bin, missingBin(f) = numBins(f), after all value bins. Categorical
+// columns hold integer codes in [0, 254] and bin each code as itself.
+class BinnedData {
+public:
+    using Bin = std::uint8_t;
+    using FeatureMatrix = std::vector<std::vector<double>>;  // Row-major
+
+    BinnedData();
+    BinnedData(const FeatureMatrix& X, int max_bins,
+               const std::vector<int>& categorical_features = {});
+
+    int numRows() const;
+    int numFeatures() const;
+    int numBins(int feature) const;  // Value bins, excluding the missing bin
+    bool isCategorical(int feature) const;
+    bool hasMissing(int feature) const;
+    int missingBin(int feature) const;
+
+    // Binned values of one feature for all rows
+    const Bin* column(int feature) const;
+
+    // Upper edge of bin `bin` (valid for bin < numBins(feature) - 1)
+    double threshold(int feature, int bin) const;
+    const std::vector<double>& edges(int feature) const;
+
+    // Bin a single raw value of a numeric feature; NaN maps to missingBin
+    Bin binValue(int feature, double x) const;
+
+    // Release the binned matrix, keeping the edges
+    void releaseBins();
+
+private:
+    int num_rows_ = 0;
+    int num_features_ = 0;
+    std::vector<Bin> bins_;                   // Column-major
+    std::vector<std::vector<double>> edges_;  // Upper edge of each bin but the last
+    std::vector<int> num_bins_;
+    std::vector<char> categorical_;
+    std::vector<char> has_missing_;
+};
@@ -5,10 +5,15 @@ class CategoricalDistribution {
 public:
     CategoricalDistribution(const std::vector<double>& probs);  // declaration only
     void set_probs(const std::vector<double>& probs);
+    // Trusted hot-path variant: no size/positivity checks, never throws.
+    // Invariants are asserted in debug builds only.
+    void set_probs_unchecked(const std::vector<double>& probs);
     const std::vector<double>& probs() const;
     double log_likelihood(const std::vector<int>& counts) const;
+    double log_likelihood_unchecked(const std::vector<int>& counts) const;
 
 private:
     void normalise();
+    void normalise_unchecked();
     std::vector<double> probabilities_;
 };
\ No newline at end of file
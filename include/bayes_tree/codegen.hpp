@@ -0,0 +1,73 @@
+#pragma once
+
+#include "bayes_tree/bayes_tree.hpp"
+#include "bayes_tree/tree_sampler.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Version of the C ABI below. Bumped whenever a symbol or its meaning changes.
+constexpr int kCompiledModelAbiVersion = 1;
+
+// Generated model sources export this C ABI:
+//   int  bayes_tree_abi_version(void);
+//   int  bayes_tree_num_classes(void);
+//   int  bayes_tree_num_features(void);
+//   void bayes_tree_predict_proba(const double* x, double* probs);
+//   void bayes_tree_predict_proba_batch(const double* X, size_t num_rows, double* probs);
+// X is row-major with bayes_tree_num_features() columns; probs receives
+// bayes_tree_num_classes() values per row.
+
+struct CodegenParams {
+    // Trees no deeper than this are walked with a fixed number of
+    // select steps over constexpr node arrays instead of nested ifs
+    int max_branchless_depth = 4;
+};
+
+// Generate C++ source for a store with Double leaves. Outputs are
+// bit-identical to store.predictProba when compiled without floating-point
+// contraction (compileSharedObject does this).
+std::string generateModelSource(const SampledTreeStore& store, int num_features,
+                                const CodegenParams& params = CodegenParams{});
+std::string generateModelSource(const BayesTree& tree, const CodegenParams& params = CodegenParams{});
+
+// Flat-array form of a fitted tree: one tree of weight 1 whose leaves hold
+// the posterior means, keeping each split's learned missing-value direction.
+// The flat form compares x <= threshold only, so trees with categorical
+// splits are rejected with std::invalid_argument.
+SampledTreeStore toSampledTreeStore(const BayesTree& tree);
+
+// Compile a generated source file into a shared object by invoking
+// `compiler` through the shell. Throws std::runtime_error on failure.
+void compileSharedObject(const std::string& source_path, const std::string& output_path,
+                         const std::string& compiler = "c++");
+
+// A generated model loaded from a shared object (POSIX dlopen)
+class CompiledModel {
+public:
+    explicit CompiledModel(const std::string& shared_object_path);
+    ~CompiledModel();
+
+    CompiledModel(CompiledModel&& other) noexcept;
+    CompiledModel& operator=(CompiledModel&& other) noexcept;
+    CompiledModel(const CompiledModel&) = delete;
+    CompiledModel& operator=(const CompiledModel&) = delete;
+
+    int getNumClasses() const;
+    int getNumFeatures() const;
+
+    std::vector<double> predictProba(const std::vector<double>& x) const;
+    // Raw entry points: x has getNumFeatures() values, probs getNumClasses()
+    void predictProba(const double* x, double* probs) const;
+    void predictProbaBatch(const double* X, std::size_t num_rows, double* probs) const;
+
+private:
+    using PredictFn = void (*)(const double*, double*);
+    using PredictBatchFn = void (*)(const double*, std::size_t, double*);
+
+    void* handle_ = nullptr;
+    int num_classes_ = 0;
+    int num_features_ = 0;
+    PredictFn predict_ = nullptr;
+    PredictBatchFn predict_batch_ = nullptr;
+};
@@ -2,6 +2,7 @@
 
 #include "dirichlet_distribution.hpp"
 #include "categorical_distribution.hpp"
+#include "sparse_counts.hpp"
 #include <vector>
 #include <memory>
 
@@ -43,6 +44,25 @@ public:
     // Log likelihood
     double getLogLikelihoodFromObservations(const std::vector<int>& counts) const;
     
+    // Unchecked variants for trusted hot-path callers: the caller guarantees
+    // counts.size() == getNumCategories() and non-negative counts. Nothing
+    // throws; the same invariants are asserted in debug builds.
+    void updateFromObservationsUnchecked(const std::vector<int>& counts);
+    double getLogLikelihoodFromObservationsUnchecked(const std::vector<int>& counts) const;
+    
+    // Sparse (index, count) variants. The likelihood costs O(nnz); the update
+    // costs O(nnz) for the alphas plus O(K) to refresh the observation
+    // distribution. See SparseConjugateCategoricalDirichlet for O(nnz) memory.
+    void updateFromObservations(const SparseCounts& counts);
+    double getLogLikelihoodFromObservations(const SparseCounts& counts) const;
+    
+    // Weighted variants: real-valued, non-negative counts such as sums of
+    // sample weights, so weighted data needs no row expansion. The marginal
+    // likelihood uses lgamma of real arguments. Separate names keep braced
+    // integer lists like {5, 3, 2} unambiguous.
+    void updateFromWeightedObservations(const std::vector<double>& counts);
+    double getLogLikelihoodFromWeightedObservations(const std::vector<double>& counts) const;
+    
     // Accessors
     const CategoricalDistribution& getObservationDistribution() const;
     const DirichletDistribution& getParameterDistribution() const;
@@ -57,6 +77,8 @@ public:
 
 private:
     void updateObservationDistribution();
+    static double latticeLogLikelihood(const std::vector<double>& alphas,
+                                       const std::vector<int>& counts);
     double gammaLn(double x) const;
     
     PriorType prior_type_;
@@ -7,8 +7,13 @@
 class DirichletDistribution {
 private:
     std::vector<double> alpha;
+    double alpha_total;  // Cached sum of alpha
+    bool half_integer_alphas;  // Cached: every alpha is a positive multiple of 1/2
     mutable std::mt19937 gen;
     
+    // Recompute alpha_total and half_integer_alphas after alpha changes
+    void updateCachedSums();
+    
 public:
     // Constructor with concentration parameters
     DirichletDistribution(const std::vector<double>& concentration_params, 
@@ -29,8 +34,18 @@ public:
     // Get concentration parameters
     const std::vector<double>& getAlpha() const;
     
+    // Get sum of concentration parameters (cached)
+    double getAlphaTotal() const;
+    
+    // True if every alpha lies on the half-integer lattice (cached)
+    bool hasHalfIntegerAlphas() const;
+    
     // Set new concentration parameters
     void setAlpha(const std::vector<double>& new_alpha);
+
+    // Set new concentration parameters without size/positivity checks.
+    // For trusted hot-path callers; invariants are asserted in debug builds.
+    void setAlphaUnchecked(const std::vector<double>& new_alpha);
     
     // Get dimensionality
     size_t dimension() const;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Structured event passed to the trace hook. Strings are static literals.
+struct TraceEvent {
+    const char* component;  // e.g. "CategoricalDistribution"
+    const char* event;      // e.g. "construct"
+    const void* object;     // Instance emitting the event (may be nullptr)
+};
+
+// Snapshot of the runtime counters
+struct InstrumentationCounters {
+    std::uint64_t categorical_constructions = 0;
+    std::uint64_t dirichlet_constructions = 0;
+    std::uint64_t conjugate_initialisations = 0;
+    std::uint64_t tree_constructions = 0;
+    std::uint64_t posterior_updates = 0;
+    std::uint64_t likelihood_evaluations = 0;
+};
+
+// Opt-in, low-overhead instrumentation.
+//
+// Counters are disabled by default; when disabled an increment costs a single
+// relaxed load. Trace points compile to nothing unless the library is built
+// with BAYES_TREE_ENABLE_TRACE (CMake option of the same name).
+class Instrumentation {
+public:
+    enum class Counter : std::size_t {
+        CategoricalConstructions,
+        DirichletConstructions,
+        ConjugateInitialisations,
+        TreeConstructions,
+        PosteriorUpdates,
+        LikelihoodEvaluations,
+        NumCounters
+    };
+
+    using TraceHook = void (*)(const TraceEvent&);
+
+    // Counters
+    static void enableCounters(bool enabled);
+    static bool countersEnabled();
+    static InstrumentationCounters counters();
+    static void resetCounters();
+
+    static void increment(Counter counter) {
+        if (counters_enabled_.load(std::memory_order_relaxed)) {
+            counters_[static_cast<std::size_t>(counter)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Tracing (only reached when BAYES_TREE_ENABLE_TRACE is defined)
+    static void setTraceHook(TraceHook hook);
+    static TraceHook traceHook();
+    static void trace(const char* component, const char* event, const void* object);
+
+    // Whether trace points were compiled into the library
+    static bool traceCompiledIn();
+
+private:
+    static constexpr std::size_t num_counters_ = static_cast<std::size_t>(Counter::NumCounters);
+
+    inline static std::atomic<bool> counters_enabled_{false};
+    inline static std::array<std::atomic<std::uint64_t>, num_counters_> counters_{};
+    inline static std::atomic<TraceHook> trace_hook_{nullptr};
+};
+
+#define BAYES_TREE_COUNT(counter) \
+    Instrumentation::increment(Instrumentation::Counter::counter)
+
+#ifdef BAYES_TREE_ENABLE_TRACE
+#define BAYES_TREE_TRACE(component, event, object) \
+    Instrumentation::trace(component, event, object)
+#else
+#define BAYES_TREE_TRACE(component, event, object) ((void)0)
+#endif
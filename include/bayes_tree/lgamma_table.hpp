@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Number of tabulated half-integer arguments: lgamma(j / 2) for
+// j < BAYES_TREE_LGAMMA_TABLE_SIZE (CMake cache variable of the same name)
+#ifndef BAYES_TREE_LGAMMA_TABLE_SIZE
+#define BAYES_TREE_LGAMMA_TABLE_SIZE 32768
+#endif
+
+// Process-wide table of lgamma over the half-integer lattice {1/2, 1, 3/2, ...}.
+// Under Jeffreys (alpha = 0.5) or integer / half-integer EqualAlpha priors,
+// every argument of the Dirichlet-multinomial marginal likelihood lies on
+// this lattice, so scoring becomes table lookups. Entries are filled once
+// with std::lgamma, so table and libm paths agree bit for bit.
+class HalfIntegerLgammaTable {
+public:
+    static const HalfIntegerLgammaTable& instance();
+
+    // lgamma(twice_x / 2) for twice_x >= 1; falls back to libm past the table
+    double operator()(long twice_x) const {
+        if (static_cast<std::size_t>(twice_x) < table_.size())
+            return table_[twice_x];
+        return std::lgamma(0.5 * static_cast<double>(twice_x));
+    }
+
+    std::size_t size() const { return table_.size(); }
+
+    // Twice x as an integer if x is a positive (half-)integer, otherwise -1.
+    // Past 2^52 (and for inf / NaN) the cast would not be exact or defined,
+    // so such x are reported off the lattice and take the libm path.
+    static long twiceIfLattice(double x) {
+        const double t = 2.0 * x;
+        if (!(t > 0.0 && t < 0x1p52)) return -1;
+        const long ti = static_cast<long>(t);
+        return static_cast<double>(ti) == t ? ti : -1;
+    }
+
+private:
+    explicit HalfIntegerLgammaTable(std::size_t size);
+    std::vector<double> table_;
+};
@@ -1,5 +1,26 @@
 #pragma once
+#include <bitset>
+#include <vector>
+
+// A node of a BayesTree, stored in the tree's flat node array.
+// Internal nodes send x[feature] <= threshold to `left`, otherwise `right`.
+// Categorical nodes send the codes in left_categories left and every other
+// code right. A missing (NaN) value goes left iff missing_left.
 class Node {
 public:
     Node();
+
+    bool isLeaf() const;
+
+    int feature = -1;
+    double threshold = 0.0;
+    int left = -1;
+    int right = -1;
+    int depth = 0;
+    bool categorical = false;
+    bool missing_left = false;            // Learned from training rows with missing values
+    std::bitset<256> left_categories;
+
+    std::vector<int> counts;                // Class counts of training rows reaching this node
+    std::vector<double> posterior_alphas;   // Dirichlet posterior (prior + counts, weighted if trained with weights)
 };
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run fn(item, thread_index) for every item in [0, num_items) on up to
+// num_threads threads, handing out items dynamically. The calling thread is
+// thread 0.
+template <typename Fn>
+void parallelFor(int num_items, int num_threads, Fn&& fn) {
+    num_threads = std::max(1, std::min(num_threads, num_items));
+    if (num_threads == 1) {
+        for (int i = 0; i < num_items; ++i) fn(i, 0);
+        return;
+    }
+
+    std::atomic<int> next{0};
+    auto worker = [&](int thread_index) {
+        for (int i = next.fetch_add(1); i < num_items; i = next.fetch_add(1)) {
+            fn(i, thread_index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : threads) t.join();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "bayes_tree/tree_sampler.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wire format on the local socket, native byte order:
+//   request:  PredictionRequestHeader, then num_features doubles
+//   response: PredictionResponseHeader, then num_classes doubles
+// num_classes = 0 rejects the request (e.g. too few features for the
+// model). Requests may be pipelined; responses on one connection can come
+// back out of order and are matched by id.
+struct PredictionRequestHeader {
+    std::uint32_t id;
+    std::uint32_t num_features;
+};
+
+struct PredictionResponseHeader {
+    std::uint32_t id;
+    std::uint32_t num_classes;
+    std::uint32_t model_version;  // Model that scored the request
+};
+
+struct PredictionServerParams {
+    std::string socket_path;
+    int max_batch_size = 64;  // Requests scored together
+    int max_wait_us = 200;    // Longest the oldest queued request waits for its batch to fill
+    std::size_t max_outbound_bytes = 1 << 20;  // Unsent responses per connection before it is closed
+};
+
+struct PredictionServerStats {
+    std::uint64_t requests = 0;
+    std::uint64_t rejected = 0;
+    std::uint64_t batches = 0;
+    std::uint64_t reloads = 0;
+    std::uint64_t slow_clients_closed = 0;  // Connections closed for not reading their responses
+};
+
+// Serves a saved SampledTreeStore over a Unix domain socket (POSIX only).
+// One I/O thread per connection queues its requests and sends its
+// responses; a single batcher thread coalesces requests into micro-batches,
+// scores each batch with SampledTreeStore::predictProbaBatch and appends the
+// responses to each connection's outbox without blocking on any client.
+class PredictionServer {
+public:
+    PredictionServer(const std::string& model_path, const PredictionServerParams& params);
+    ~PredictionServer();
+
+    PredictionServer(const PredictionServer&) = delete;
+    PredictionServer& operator=(const PredictionServer&) = delete;
+
+    // Bind the socket and start serving; stop() finishes queued requests
+    // and closes all connections
+    void start();
+    void stop();
+
+    // Load a new model and swap it in. Batches already taken from the queue
+    // finish on the model they started with; if loading throws, the old
+    // model stays active.
+    void reloadModel(const std::string& model_path);
+
+    std::uint32_t getModelVersion() const;
+    PredictionServerStats getStats() const;
+
+private:
+    struct Model {
+        SampledTreeStore store;
+        int num_features_used = 0;
+        std::uint32_t version = 0;
+    };
+
+    struct Connection;
+
+    struct Pending {
+        std::shared_ptr<Connection> connection;
+        std::uint32_t id;
+        std::vector<double> x;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    struct ConnectionThread {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    void acceptLoop();
+    void connectionLoop(const std::shared_ptr<Connection>& connection);
+    bool enqueue(Pending&& pending);
+    void batchLoop();
+    void scoreBatch(std::vector<Pending>& batch);
+    std::shared_ptr<const Model> currentModel() const;
+
+    PredictionServerParams params_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex model_mutex_;
+    std::shared_ptr<const Model> model_;
+    std::uint32_t next_version_ = 1;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Pending> queue_;
+    bool stopping_ = false;
+
+    std::thread acceptor_;
+    std::thread batcher_;
+    std::mutex connections_mutex_;
+    std::list<ConnectionThread> connections_;
+
+    std::atomic<std::uint64_t> requests_{0};
+    std::atomic<std::uint64_t> rejected_{0};
+    std::atomic<std::uint64_t> batches_{0};
+    std::atomic<std::uint64_t> reloads_{0};
+    std::atomic<std::uint64_t> slow_clients_closed_{0};
+};
+
+// Blocking client for PredictionServer. send/receive allow pipelining;
+// predictProba is one synchronous round trip.
+class PredictionClient {
+public:
+    struct Response {
+        std::uint32_t id = 0;
+        std::uint32_t model_version = 0;
+        std::vector<double> probs;  // Empty if the server rejected the request
+    };
+
+    explicit PredictionClient(const std::string& socket_path);
+    ~PredictionClient();
+
+    PredictionClient(const PredictionClient&) = delete;
+    PredictionClient& operator=(const PredictionClient&) = delete;
+
+    void send(std::uint32_t id, const std::vector<double>& x);
+    Response receive();
+
+    // Throws std::runtime_error if the request is rejected
+    std::vector<double> predictProba(const std::vector<double>& x);
+
+private:
+    int fd_ = -1;
+    std::uint32_t next_id_ = 0;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Training phases timed by the profiler
+enum class TrainingPhase : std::size_t {
+    Binning,        // Quantile binning of the raw feature matrix
+    Histogram,      // Per-node class-count histograms
+    SplitScoring,   // Marginal-likelihood scan over candidate splits
+    Partition,      // Moving row indices into the children
+    NumPhases
+};
+
+constexpr std::size_t kNumTrainingPhases = static_cast<std::size_t>(TrainingPhase::NumPhases);
+
+const char* trainingPhaseName(TrainingPhase phase);
+
+struct PhaseTiming {
+    double wall_seconds = 0.0;
+    double cpu_seconds = 0.0;
+};
+
+// Work done by a single training thread
+struct ThreadReport {
+    int thread_index = 0;
+    std::array<PhaseTiming, kNumTrainingPhases> phases{};
+    std::uint64_t nodes_processed = 0;
+    std::uint64_t candidate_splits_scored = 0;
+    std::uint64_t candidate_splits_pruned = 0;  // Skipped by upper bounds (BayesTreeParams::prune_splits)
+    std::uint64_t features_pruned = 0;          // Features whose every cut was skipped at once
+    std::uint64_t split_bounds_evaluated = 0;
+    std::uint64_t likelihood_evaluations = 0;
+    std::uint64_t bytes_touched = 0;
+};
+
+// Work done at one depth of the tree
+struct LevelReport {
+    int depth = 0;
+    int num_nodes = 0;
+    int num_splits = 0;
+    std::uint64_t num_rows = 0;
+    std::uint64_t bytes_touched = 0;
+    double wall_seconds = 0.0;
+};
+
+// Structured report returned by BayesTree::getTrainingReport().
+// Phase totals are summed over threads, so with several threads they can
+// exceed total_wall_seconds.
+struct TrainingReport {
+    bool profiling_enabled = false;
+    double total_wall_seconds = 0.0;
+    std::array<PhaseTiming, kNumTrainingPhases> phases{};
+    std::uint64_t candidate_splits_scored = 0;
+    std::uint64_t candidate_splits_pruned = 0;
+    std::uint64_t features_pruned = 0;
+    std::uint64_t split_bounds_evaluated = 0;
+    std::uint64_t likelihood_evaluations = 0;
+    std::uint64_t bytes_touched = 0;
+    std::vector<LevelReport> levels;
+    std::vector<ThreadReport> threads;
+
+    // Sum the per-thread reports into the totals above
+    void aggregateThreads();
+};
+
+// Wall-clock and calling-thread CPU time, in seconds
+double wallSeconds();
+double threadCpuSeconds();
+
+// Adds the wall/CPU time of its lifetime to one phase of a ThreadReport
+class ScopedPhaseTimer {
+public:
+    ScopedPhaseTimer(ThreadReport& report, TrainingPhase phase);
+    ~ScopedPhaseTimer();
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+    PhaseTiming& timing_;
+    double wall_start_;
+    double cpu_start_;
+};
+
+// Profiling hooks compile out entirely unless BAYES_TREE_ENABLE_PROFILING is
+// defined (CMake option of the same name).
+#ifdef BAYES_TREE_ENABLE_PROFILING
+#define BAYES_TREE_PROFILE_CONCAT_INNER_(a, b) a##b
+#define BAYES_TREE_PROFILE_CONCAT_(a, b) BAYES_TREE_PROFILE_CONCAT_INNER_(a, b)
+#define BAYES_TREE_PROFILE_PHASE(thread_report, phase) \
+    ScopedPhaseTimer BAYES_TREE_PROFILE_CONCAT_(profile_scope_, __LINE__)(thread_report, TrainingPhase::phase)
+#define BAYES_TREE_PROFILE_ADD(lvalue, amount) ((lvalue) += (amount))
+#else
+// sizeof keeps the operands unevaluated while avoiding unused-variable warnings
+#define BAYES_TREE_PROFILE_PHASE(thread_report, phase) ((void)sizeof(thread_report))
+#define BAYES_TREE_PROFILE_ADD(lvalue, amount) ((void)sizeof((lvalue) += (amount)))
+#endif
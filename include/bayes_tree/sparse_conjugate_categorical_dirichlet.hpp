@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bayes_tree/sparse_counts.hpp"
+#include <vector>
+
+// Dirichlet-categorical conjugate pair for very many categories (K ~ 1e5)
+// of which few are observed. The prior is symmetric (Jeffreys or
+// EqualAlpha) and the posterior is stored as prior plus a sparse count
+// delta, so memory and per-call work scale with the number of observed
+// categories rather than K. Prior-only terms are cached.
+class SparseConjugateCategoricalDirichlet {
+public:
+    explicit SparseConjugateCategoricalDirichlet(int num_categories);  // Jeffreys prior
+    SparseConjugateCategoricalDirichlet(int num_categories, double alpha);
+
+    // Add observed counts to the posterior, O(nnz + observed categories)
+    void updateFromObservations(const SparseCounts& counts);
+
+    // Marginalised log likelihood of counts, O(nnz log observed categories)
+    double getLogLikelihoodFromObservations(const SparseCounts& counts) const;
+
+    // Accessors
+    int getNumCategories() const;
+    int getNumObservedCategories() const;
+    double getPriorAlpha() const;
+    double getAlpha(int category) const;       // Posterior alpha
+    double getAlphaTotal() const;
+    double getMean(int category) const;        // Posterior mean probability
+    const SparseCounts& getObservedCounts() const;
+    std::vector<double> getAlphas() const;     // Dense, O(K)
+
+private:
+    int observedCount(int category) const;
+
+    int num_categories_;
+    double prior_alpha_;
+    SparseCounts delta_;         // Observed counts, strictly increasing indices
+    long total_count_ = 0;
+
+    // Cached prior-only terms
+    double prior_alpha_total_;
+    double lgamma_prior_alpha_;
+    long twice_prior_alpha_;     // > 0 if the prior lies on the half-integer lattice
+};
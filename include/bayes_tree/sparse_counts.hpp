@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+
+// One non-zero entry of a category count vector
+struct SparseCount {
+    int index;
+    int count;
+};
+
+// Non-zero counts with strictly increasing indices
+using SparseCounts = std::vector<SparseCount>;
+
+// Throws std::invalid_argument unless indices are strictly increasing and in
+// [0, num_categories) and counts are non-negative
+void validateSparseCounts(const SparseCounts& counts, int num_categories);
+
+// Dense <-> sparse conversion
+SparseCounts toSparseCounts(const std::vector<int>& dense);
+std::vector<int> toDenseCounts(const SparseCounts& sparse, int num_categories);
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "bayes_tree/binned_data.hpp"
+#include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Storage of leaf posterior means in a SampledTreeStore
+enum class LeafFormat : std::uint8_t {
+    Double,   // 8 bytes per class
+    Float16,  // IEEE half precision, ~3 significant digits
+    UInt16    // Fixed point with a per-tree scale, absolute error <= max leaf prob / 131070
+};
+
+struct TreeSamplerParams {
+    int num_chains = 4;
+    int num_iterations = 1000;  // MCMC steps per chain, including burn-in
+    int burn_in = 200;
+    int thin = 1;               // Keep every thin-th post-burn-in state
+    int num_threads = 1;        // Chains run in parallel
+    int max_depth = 8;
+    int min_samples_leaf = 1;
+    int max_bins = 64;
+    double prior_alpha = 0.5;   // Symmetric Dirichlet leaf prior; 0.5 is Jeffreys
+    double split_alpha = 0.95;  // Tree prior: P(split at depth d) = split_alpha * (1 + d)^-split_beta
+    double split_beta = 2.0;
+    std::uint64_t seed = 0;
+    LeafFormat leaf_format = LeafFormat::Double;  // Compress the sample store after fitting
+};
+
+// Counter-based random stream (SplitMix64 over a per-stream key). The n-th
+// draw of stream s depends only on (seed, s, n), so results do not depend
+// on thread scheduling.
+class CounterRng {
+public:
+    CounterRng(std::uint64_t seed, std::uint64_t stream);
+
+    std::uint64_t next();
+    double uniform();              // [0, 1)
+    int uniformInt(int n);         // [0, n)
+
+private:
+    std::uint64_t key_;
+    std::uint64_t counter_ = 0;
+};
+
+// Sampled trees packed into shared flat arrays. A sample that repeats the
+// previous state of its chain only bumps that tree's weight.
+//
+// Leaves can be compressed into 16-bit codes. Identical code vectors are
+// stored once in a dictionary shared by all trees, which pays off because
+// consecutive MCMC samples differ in only a few leaves.
+class SampledTreeStore {
+public:
+    void clear(int num_classes);
+
+    // Append a tree with weight 1 and return its index. Node arrays use
+    // tree-local indices; leaves have feature < 0 and left = local leaf index
+    // k, whose class probabilities are leaf_probs[k * K, (k + 1) * K). A split
+    // sends x left if x <= threshold, or if x is NaN and missing_left is set
+    // (an empty missing_left sends every NaN right).
+    int addTree(const std::vector<int>& feature, const std::vector<double>& threshold,
+                const std::vector<int>& left, const std::vector<int>& right,
+                const std::vector<double>& leaf_probs,
+                const std::vector<std::uint8_t>& missing_left = {});
+    void addWeight(int tree, std::uint32_t weight = 1);
+
+    // Append all trees of another store with the same number of classes.
+    // Neither store may be compressed.
+    void merge(const SampledTreeStore& other);
+
+    // Quantise all leaves to format and share identical ones. One-way: a
+    // compressed store accepts no further trees.
+    void compressLeaves(LeafFormat format);
+
+    std::size_t numTrees() const;
+    std::uint64_t totalWeight() const;
+    std::size_t memoryBytes() const;
+    LeafFormat getLeafFormat() const;
+    std::size_t numLeafEntries() const;  // Distinct stored leaf vectors
+
+    // Weighted average of the posterior mean at the leaf reached by x, which
+    // needs at least getNumFeaturesUsed() values. Compressed leaves are
+    // decoded on the fly and the result renormalised.
+    std::vector<double> predictProba(const std::vector<double>& x) const;
+    // Row-major X with row_stride >= getNumFeaturesUsed() values per row;
+    // probs receives K per row. Results equal predictProba row by row.
+    void predictProbaBatch(const double* X, std::size_t num_rows, std::size_t row_stride,
+                           double* probs) const;
+    // One more than the largest feature index any split reads
+    int getNumFeaturesUsed() const;
+
+    // Raw flat arrays, for exporters (see codegen.hpp)
+    int getNumClasses() const;
+    const std::vector<std::uint32_t>& getTreeOffsets() const;
+    const std::vector<std::uint32_t>& getWeights() const;
+    const std::vector<std::int32_t>& getFeatures() const;
+    const std::vector<double>& getThresholds() const;
+    const std::vector<std::int32_t>& getLeft() const;
+    const std::vector<std::int32_t>& getRight() const;
+    const std::vector<std::uint8_t>& getMissingLeft() const;
+    const std::vector<double>& getLeafProbs() const;  // Empty once compressed
+
+    // Binary model file in native byte order
+    void save(std::ostream& out) const;
+    static SampledTreeStore load(std::istream& in);
+
+private:
+    int num_classes_ = 0;
+    std::vector<std::uint32_t> tree_offset_;   // First node of each tree
+    std::vector<std::uint32_t> weight_;
+    std::uint64_t total_weight_ = 0;
+    int num_features_used_ = 0;  // One more than the largest split feature
+
+    // Per node, children relative to the tree offset; leaves have
+    // feature < 0 and left = global leaf slot (dictionary entry once
+    // compressed)
+    std::vector<std::int32_t> feature_;
+    std::vector<double> threshold_;
+    std::vector<std::int32_t> left_;
+    std::vector<std::int32_t> right_;
+    std::vector<std::uint8_t> missing_left_;  // 1 if the split sends NaN left
+    std::vector<double> leaf_probs_;
+
+    // Compressed leaves: K codes per dictionary entry, decoded as
+    // tree_scale_[t] * code (UInt16) or half-to-float (Float16)
+    LeafFormat leaf_format_ = LeafFormat::Double;
+    std::vector<double> tree_scale_;
+    std::vector<std::uint16_t> leaf_codes_;
+};
+
+struct ChainReport {
+    int chain = 0;
+    std::uint64_t grow_proposed = 0, grow_accepted = 0;
+    std::uint64_t prune_proposed = 0, prune_accepted = 0;
+    std::uint64_t change_proposed = 0, change_accepted = 0;
+    std::uint64_t leaf_likelihood_evaluations = 0;
+    std::vector<double> log_likelihood_trace;  // Sum of leaf marginal likelihoods per iteration
+    std::vector<int> num_leaves_trace;
+};
+
+// Bayesian model averaging over tree structures (Chipman-George-McCulloch
+// style grow / prune / change Metropolis-Hastings). Leaves are scored by the
+// Dirichlet-multinomial marginal likelihood of their cached class counts,
+// so each move only rescores the leaves it touches.
+class TreeSampler {
+public:
+    using FeatureMatrix = BinnedData::FeatureMatrix;
+
+    TreeSampler();
+    explicit TreeSampler(const TreeSamplerParams& params);
+
+    void fit(const FeatureMatrix& X, const std::vector<int>& y, int num_classes = 0);
+
+    // Posterior predictive class probabilities averaged over sampled trees
+    std::vector<double> predictProba(const std::vector<double>& x) const;
+    std::vector<std::vector<double>> predictProba(const FeatureMatrix& X) const;
+
+    const SampledTreeStore& getSamples() const;
+    const std::vector<ChainReport>& getChainReports() const;
+    const TreeSamplerParams& getParams() const;
+    int getNumClasses() const;
+
+private:
+    class Chain;
+
+    TreeSamplerParams params_;
+    int num_classes_ = 0;
+    int num_features_ = 0;
+    ConjugateCategoricalDirichlet prior_;
+    SampledTreeStore samples_;
+    std::vector<ChainReport> reports_;
+};
@@ -1,15 +1,153 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>  // for automatic conversion of std::vector <-> Python lists
 #include "bayes_tree/bayes_tree.hpp"
+#include "bayes_tree/codegen.hpp"
 #include "bayes_tree/dirichlet_distribution.hpp"
 #include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/sparse_conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/tree_sampler.hpp"
+#include <fstream>
 
 namespace py = pybind11;
 
 PYBIND11_MODULE(pybayes_tree, m) {
+    py::class_<BayesTreeParams>(m, "BayesTreeParams")
+        .def(py::init<>())
+        .def_readwrite("max_depth", &BayesTreeParams::max_depth)
+        .def_readwrite("min_samples_leaf", &BayesTreeParams::min_samples_leaf)
+        .def_readwrite("max_bins", &BayesTreeParams::max_bins)
+        .def_readwrite("prior_alpha", &BayesTreeParams::prior_alpha)
+        .def_readwrite("min_gain", &BayesTreeParams::min_gain)
+        .def_readwrite("num_threads", &BayesTreeParams::num_threads)
+        .def_readwrite("hierarchical_prior", &BayesTreeParams::hierarchical_prior)
+        .def_readwrite("prior_concentration", &BayesTreeParams::prior_concentration)
+        .def_readwrite("categorical_features", &BayesTreeParams::categorical_features)
+        .def_readwrite("prune_splits", &BayesTreeParams::prune_splits);
+
     py::class_<BayesTree>(m, "BayesTree")
         .def(py::init<>())
-        .def("predict", &BayesTree::predict);
+        .def(py::init<const BayesTreeParams&>(), py::arg("params"))
+        .def("predict", &BayesTree::predict)
+        .def("fit", py::overload_cast<const BayesTree::FeatureMatrix&, const std::vector<int>&, int>(&BayesTree::fit),
+             py::arg("X"), py::arg("y"), py::arg("num_classes") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("fit", py::overload_cast<const BayesTree::FeatureMatrix&, const std::vector<int>&,
+                                      const std::vector<double>&, int>(&BayesTree::fit),
+             py::arg("X"), py::arg("y"), py::arg("sample_weight"), py::arg("num_classes") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("predict_proba", py::overload_cast<const BayesTree::FeatureMatrix&>(&BayesTree::predictProba, py::const_))
+        .def("predict_class", &BayesTree::predictClass)
+        .def("num_nodes", &BayesTree::getNumNodes)
+        .def("num_leaves", &BayesTree::getNumLeaves)
+        .def("depth", &BayesTree::getDepth)
+        .def("training_report", [](const BayesTree& self) {
+            const auto& r = self.getTrainingReport();
+            auto phases_to_dict = [](const std::array<PhaseTiming, kNumTrainingPhases>& phases) {
+                py::dict d;
+                for (std::size_t p = 0; p < kNumTrainingPhases; ++p) {
+                    py::dict t;
+                    t["wall_seconds"] = phases[p].wall_seconds;
+                    t["cpu_seconds"] = phases[p].cpu_seconds;
+                    d[trainingPhaseName(static_cast<TrainingPhase>(p))] = t;
+                }
+                return d;
+            };
+
+            py::dict d;
+            d["profiling_enabled"] = r.profiling_enabled;
+            d["total_wall_seconds"] = r.total_wall_seconds;
+            d["phases"] = phases_to_dict(r.phases);
+            d["candidate_splits_scored"] = r.candidate_splits_scored;
+            d["candidate_splits_pruned"] = r.candidate_splits_pruned;
+            d["features_pruned"] = r.features_pruned;
+            d["split_bounds_evaluated"] = r.split_bounds_evaluated;
+            d["likelihood_evaluations"] = r.likelihood_evaluations;
+            d["bytes_touched"] = r.bytes_touched;
+
+            py::list levels;
+            for (const auto& l : r.levels) {
+                py::dict ld;
+                ld["depth"] = l.depth;
+                ld["num_nodes"] = l.num_nodes;
+                ld["num_splits"] = l.num_splits;
+                ld["num_rows"] = l.num_rows;
+                ld["bytes_touched"] = l.bytes_touched;
+                ld["wall_seconds"] = l.wall_seconds;
+                levels.append(ld);
+            }
+            d["levels"] = levels;
+
+            py::list threads;
+            for (const auto& t : r.threads) {
+                py::dict td;
+                td["thread_index"] = t.thread_index;
+                td["phases"] = phases_to_dict(t.phases);
+                td["nodes_processed"] = t.nodes_processed;
+                td["candidate_splits_scored"] = t.candidate_splits_scored;
+                td["candidate_splits_pruned"] = t.candidate_splits_pruned;
+                td["features_pruned"] = t.features_pruned;
+                td["split_bounds_evaluated"] = t.split_bounds_evaluated;
+                td["likelihood_evaluations"] = t.likelihood_evaluations;
+                td["bytes_touched"] = t.bytes_touched;
+                threads.append(td);
+            }
+            d["threads"] = threads;
+            return d;
+        });
+
+    py::enum_<LeafFormat>(m, "LeafFormat")
+        .value("Double", LeafFormat::Double)
+        .value("Float16", LeafFormat::Float16)
+        .value("UInt16", LeafFormat::UInt16);
+
+    py::class_<TreeSamplerParams>(m, "TreeSamplerParams")
+        .def(py::init<>())
+        .def_readwrite("num_chains", &TreeSamplerParams::num_chains)
+        .def_readwrite("num_iterations", &TreeSamplerParams::num_iterations)
+        .def_readwrite("burn_in", &TreeSamplerParams::burn_in)
+        .def_readwrite("thin", &TreeSamplerParams::thin)
+        .def_readwrite("num_threads", &TreeSamplerParams::num_threads)
+        .def_readwrite("max_depth", &TreeSamplerParams::max_depth)
+        .def_readwrite("min_samples_leaf", &TreeSamplerParams::min_samples_leaf)
+        .def_readwrite("max_bins", &TreeSamplerParams::max_bins)
+        .def_readwrite("prior_alpha", &TreeSamplerParams::prior_alpha)
+        .def_readwrite("split_alpha", &TreeSamplerParams::split_alpha)
+        .def_readwrite("split_beta", &TreeSamplerParams::split_beta)
+        .def_readwrite("seed", &TreeSamplerParams::seed)
+        .def_readwrite("leaf_format", &TreeSamplerParams::leaf_format);
+
+    py::class_<TreeSampler>(m, "TreeSampler")
+        .def(py::init<>())
+        .def(py::init<const TreeSamplerParams&>(), py::arg("params"))
+        .def("fit", &TreeSampler::fit, py::arg("X"), py::arg("y"), py::arg("num_classes") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("predict_proba", py::overload_cast<const TreeSampler::FeatureMatrix&>(&TreeSampler::predictProba, py::const_))
+        .def("num_stored_trees", [](const TreeSampler& self) { return self.getSamples().numTrees(); })
+        .def("num_samples", [](const TreeSampler& self) { return self.getSamples().totalWeight(); })
+        .def("memory_bytes", [](const TreeSampler& self) { return self.getSamples().memoryBytes(); })
+        .def("save", [](const TreeSampler& self, const std::string& path) {
+            std::ofstream out(path, std::ios::binary);
+            self.getSamples().save(out);
+        }, py::arg("path"))
+        .def("chain_reports", [](const TreeSampler& self) {
+            py::list out;
+            for (const auto& r : self.getChainReports()) {
+                py::dict d;
+                d["chain"] = r.chain;
+                d["grow_proposed"] = r.grow_proposed;
+                d["grow_accepted"] = r.grow_accepted;
+                d["prune_proposed"] = r.prune_proposed;
+                d["prune_accepted"] = r.prune_accepted;
+                d["change_proposed"] = r.change_proposed;
+                d["change_accepted"] = r.change_accepted;
+                d["leaf_likelihood_evaluations"] = r.leaf_likelihood_evaluations;
+                d["log_likelihood_trace"] = r.log_likelihood_trace;
+                d["num_leaves_trace"] = r.num_leaves_trace;
+                out.append(d);
+            }
+            return out;
+        });
 
     py::class_<DirichletDistribution>(m, "DirichletDistribution")
         .def(py::init<const std::vector<double>&, unsigned int>(),
@@ -39,8 +177,10 @@ PYBIND11_MODULE(pybayes_tree, m) {
          .def("setJeffreysPrior", &ConjugateCategoricalDirichlet::setJeffreysPrior)
          .def("setAllParameterAlphasTo", &ConjugateCategoricalDirichlet::setAllParameterAlphasTo)
          .def("setJeffreysFromObservationDistribution", &ConjugateCategoricalDirichlet::setJeffreysFromObservationDistribution)
-         .def("updateFromObservations", &ConjugateCategoricalDirichlet::updateFromObservations)
-         .def("getLogLikelihoodFromObservations", &ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations)
+         .def("updateFromObservations", py::overload_cast<const std::vector<int>&>(&ConjugateCategoricalDirichlet::updateFromObservations))
+         .def("getLogLikelihoodFromObservations", py::overload_cast<const std::vector<int>&>(&ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations, py::const_))
+         .def("updateFromWeightedObservations", &ConjugateCategoricalDirichlet::updateFromWeightedObservations)
+         .def("getLogLikelihoodFromWeightedObservations", &ConjugateCategoricalDirichlet::getLogLikelihoodFromWeightedObservations)
 //     // Accessors: NEXT 2 LINES THROW ERRORS
       //   .def("getObservationDistribution", &ConjugateCategoricalDirichlet::getObservationDistribution, py::return_value_policy::reference)
        //    .def("getParameterDistribution", &ConjugateCategoricalDirichlet::getParameterDistribution, py::return_value_policy::reference)
@@ -50,11 +190,60 @@ PYBIND11_MODULE(pybayes_tree, m) {
            .def("getAlphas", &ConjugateCategoricalDirichlet::getAlphas)
         ;
 
+    // Sparse counts are passed as lists of (index, count) pairs
+    auto to_sparse = [](const std::vector<std::pair<int, int>>& pairs) {
+        SparseCounts counts;
+        counts.reserve(pairs.size());
+        for (const auto& p : pairs) counts.push_back({p.first, p.second});
+        return counts;
+    };
+
+    py::class_<SparseConjugateCategoricalDirichlet>(m, "SparseConjugateCategoricalDirichlet")
+        .def(py::init<int>())
+        .def(py::init<int, double>())
+        .def("updateFromObservations", [to_sparse](SparseConjugateCategoricalDirichlet& self,
+                                                   const std::vector<std::pair<int, int>>& counts) {
+            self.updateFromObservations(to_sparse(counts));
+        })
+        .def("getLogLikelihoodFromObservations", [to_sparse](const SparseConjugateCategoricalDirichlet& self,
+                                                             const std::vector<std::pair<int, int>>& counts) {
+            return self.getLogLikelihoodFromObservations(to_sparse(counts));
+        })
+        .def("getNumCategories", &SparseConjugateCategoricalDirichlet::getNumCategories)
+        .def("getNumObservedCategories", &SparseConjugateCategoricalDirichlet::getNumObservedCategories)
+        .def("getAlpha", &SparseConjugateCategoricalDirichlet::getAlpha)
+        .def("getMean", &SparseConjugateCategoricalDirichlet::getMean)
+        .def("getAlphaTotal", &SparseConjugateCategoricalDirichlet::getAlphaTotal);
+
     py::enum_<ConjugateCategoricalDirichlet::PriorType>(m, "PriorType")
         .value("Jeffreys", ConjugateCategoricalDirichlet::PriorType::Jeffreys)
         .value("EqualAlpha", ConjugateCategoricalDirichlet::PriorType::EqualAlpha)
         .value("ManualAlphas", ConjugateCategoricalDirichlet::PriorType::ManualAlphas)
         .value("ManualProbs", ConjugateCategoricalDirichlet::PriorType::ManualProbs);
 
+    // Instrumentation counters (trace hook is C++ only)
+    m.def("enable_counters", &Instrumentation::enableCounters, py::arg("enabled") = true);
+    m.def("counters_enabled", &Instrumentation::countersEnabled);
+    m.def("reset_counters", &Instrumentation::resetCounters);
+    m.def("trace_compiled_in", &Instrumentation::traceCompiledIn);
+    m.def("get_counters", []() {
+        auto c = Instrumentation::counters();
+        py::dict d;
+        d["categorical_constructions"] = c.categorical_constructions;
+        d["dirichlet_constructions"] = c.dirichlet_constructions;
+        d["conjugate_initialisations"] = c.conjugate_initialisations;
+        d["tree_constructions"] = c.tree_constructions;
+        d["posterior_updates"] = c.posterior_updates;
+        d["likelihood_evaluations"] = c.likelihood_evaluations;
+        return d;
+    });
+
+    // Compiled inference source export
+    m.def("generate_model_source", [](const BayesTree& tree, int max_branchless_depth) {
+        CodegenParams params;
+        params.max_branchless_depth = max_branchless_depth;
+        return generateModelSource(tree, params);
+    }, py::arg("tree"), py::arg("max_branchless_depth") = CodegenParams{}.max_branchless_depth);
+
 
 }
@@ -1,12 +1,732 @@
 #include "bayes_tree/bayes_tree.hpp"
-#include <iostream>
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/lgamma_table.hpp"
+#include "bayes_tree/parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// Cut ranges this short are scored directly: bounding them costs about as
+// much as scoring them
+constexpr int kExactCutRange = 8;
+
+// Digamma for x > 0: recurrence up to x >= 6, then the asymptotic series
+// (absolute error below 1e-11)
+double digamma(double x) {
+    double result = 0.0;
+    for (; x < 6.0; x += 1.0) result -= 1.0 / x;
+    const double inv = 1.0 / x;
+    const double inv2 = inv * inv;
+    return result + std::log(x) - 0.5 * inv
+         - inv2 * (1.0 / 12.0 - inv2 * (1.0 / 120.0 - inv2 * (1.0 / 252.0 - inv2 * (1.0 / 240.0 - inv2 / 132.0))));
+}
+
+}  // namespace
 
 // Define the constructor
-BayesTree::BayesTree() {
-    std::cout << "BayesTree constructed.\n";
+BayesTree::BayesTree() : BayesTree(BayesTreeParams{}) {}
+
+BayesTree::BayesTree(const BayesTreeParams& params) : params_(params) {
+    if (params_.max_bins < 2 || params_.max_bins > 256)
+        throw std::invalid_argument("max_bins must be in [2, 256]");
+    if (params_.prior_alpha <= 0.0)
+        throw std::invalid_argument("prior_alpha must be positive");
+
+    BAYES_TREE_COUNT(TreeConstructions);
+    BAYES_TREE_TRACE("BayesTree", "construct", this);
 }
 
 // Define the predict function
 double BayesTree::predict(double x) const {
     return 2.0 * x + 1.0;
 }
+
+void BayesTree::fit(const FeatureMatrix& X, const std::vector<int>& y, int num_classes) {
+    train<int>(X, y, nullptr, num_classes);
+}
+
+void BayesTree::fit(const FeatureMatrix& X, const std::vector<int>& y,
+                    const std::vector<double>& sample_weight, int num_classes) {
+    if (sample_weight.size() != y.size())
+        throw std::invalid_argument("sample_weight must have one weight per row");
+    for (double w : sample_weight) {
+        if (!std::isfinite(w) || w < 0.0)
+            throw std::invalid_argument("Sample weights must be finite and non-negative");
+    }
+    train<double>(X, y, sample_weight.data(), num_classes);
+}
+
+template <typename Count>
+void BayesTree::train(const FeatureMatrix& X, const std::vector<int>& y, const double* sample_weight,
+                      int num_classes) {
+    if (X.size() != y.size())
+        throw std::invalid_argument("X and y must have the same number of rows");
+    if (y.empty())
+        throw std::invalid_argument("Training data cannot be empty");
+
+    int max_label = *std::max_element(y.begin(), y.end());
+    if (*std::min_element(y.begin(), y.end()) < 0)
+        throw std::invalid_argument("Class labels must be non-negative");
+    num_classes_ = num_classes > 0 ? num_classes : max_label + 1;
+    if (max_label >= num_classes_)
+        throw std::invalid_argument("Class label out of range for num_classes");
+    num_classes_ = std::max(num_classes_, 2);
+
+    const int num_threads = std::max(1, params_.num_threads);
+    report_ = TrainingReport{};
+#ifdef BAYES_TREE_ENABLE_PROFILING
+    report_.profiling_enabled = true;
+#endif
+    report_.threads.resize(num_threads);
+    for (int t = 0; t < num_threads; ++t) report_.threads[t].thread_index = t;
+    const double fit_start = wallSeconds();
+
+    {
+        BAYES_TREE_PROFILE_PHASE(report_.threads[0], Binning);
+        binned_ = BinnedData(X, params_.max_bins, params_.categorical_features);
+    }
+    num_rows_ = binned_.numRows();
+    num_features_ = binned_.numFeatures();
+
+    nodes_.clear();
+    nodes_.emplace_back();
+
+    // One row-index array for the whole build: every frontier node owns a
+    // contiguous subrange that is partitioned in place when it splits
+    row_index_.resize(num_rows_);
+    row_scratch_.resize(num_rows_);
+    for (int i = 0; i < num_rows_; ++i) row_index_[i] = i;
+
+    const int K = num_classes_;
+    const bool hierarchical = params_.hierarchical_prior;
+
+    // Without hierarchical shrinkage every node uses row 0, the base prior
+    LevelPriors priors;
+    priors.resize(1, K);
+    std::fill(priors.alphas.begin(), priors.alphas.end(), params_.prior_alpha);
+    priors.computeTerms();
+
+    std::vector<FrontierNode> frontier{{0, 0, num_rows_, 0}};
+
+    // Row i holds the (weighted) class counts of frontier[i]. Children get
+    // theirs from the winning split's histogram, so only the root needs a
+    // pass over y.
+    std::vector<Count> counts(K, 0);
+    for (std::size_t i = 0; i < y.size(); ++i) {
+        if constexpr (std::is_same_v<Count, int>)
+            ++counts[y[i]];
+        else
+            counts[y[i]] += sample_weight[i];
+    }
+
+    for (int depth = 0; !frontier.empty(); ++depth) {
+        const double level_start = wallSeconds();
+        std::vector<SplitResult> results(frontier.size());
+
+        LevelPriors child_priors;
+        if (hierarchical && depth < params_.max_depth)
+            deriveChildPriors(frontier, counts, priors, child_priors);
+        const LevelPriors& split_priors = hierarchical ? child_priors : priors;
+
+        parallelFor(static_cast<int>(frontier.size()), num_threads, [&](int i, int t) {
+            results[i] = processNode(frontier[i], depth, y, sample_weight,
+                                     counts.data() + std::size_t(i) * K, priors, split_priors,
+                                     hierarchical ? i : 0, report_.threads[t]);
+            BAYES_TREE_PROFILE_ADD(report_.threads[t].bytes_touched, results[i].bytes_touched);
+        });
+
+        LevelReport level;
+        level.depth = depth;
+        level.num_nodes = static_cast<int>(frontier.size());
+
+        std::vector<FrontierNode> next_frontier;
+        std::vector<Count> next_counts;
+        for (std::size_t i = 0; i < frontier.size(); ++i) {
+            const int index = frontier[i].node_index;
+            const SplitResult& result = results[i];
+            const Count* node_counts = counts.data() + i * K;
+            const double* node_prior = priors.row(frontier[i].prior_row);
+
+            level.num_rows += frontier[i].end - frontier[i].begin;
+            BAYES_TREE_PROFILE_ADD(level.bytes_touched, result.bytes_touched);
+
+            Node& node = nodes_[index];
+            node.depth = depth;
+            if constexpr (std::is_same_v<Count, int>) {
+                node.counts.assign(node_counts, node_counts + K);
+            } else {
+                // The rows are still grouped under this node, split or not
+                node.counts.assign(K, 0);
+                for (int r = frontier[i].begin; r < frontier[i].end; ++r) ++node.counts[y[row_index_[r]]];
+            }
+            node.posterior_alphas.resize(K);
+            for (int k = 0; k < K; ++k) node.posterior_alphas[k] = node_prior[k] + node_counts[k];
+
+            if (!result.split) continue;
+
+            ++level.num_splits;
+            const int left = static_cast<int>(nodes_.size());
+            node.feature = result.feature;
+            node.categorical = result.categorical;
+            node.missing_left = result.missing_left;
+            if (result.categorical)
+                node.left_categories = result.left_bins;
+            else if (result.bin + 1 < binned_.numBins(result.feature))
+                node.threshold = binned_.threshold(result.feature, result.bin);
+            else
+                node.threshold = std::numeric_limits<double>::infinity();  // Splits off the missing rows only
+            node.left = left;
+            node.right = left + 1;
+
+            nodes_.emplace_back();  // Invalidates `node`
+            nodes_.emplace_back();
+            const int child_row = hierarchical ? static_cast<int>(i) : 0;
+            next_frontier.push_back({left, frontier[i].begin, result.split_point, child_row});
+            next_frontier.push_back({left + 1, result.split_point, frontier[i].end, child_row});
+
+            // Left counts are stored as doubles; integer counts convert back exactly
+            std::vector<Count> left_counts(result.left_counts.begin(), result.left_counts.end());
+            next_counts.insert(next_counts.end(), left_counts.begin(), left_counts.end());
+            for (int k = 0; k < K; ++k) next_counts.push_back(node_counts[k] - left_counts[k]);
+        }
+
+        level.wall_seconds = wallSeconds() - level_start;
+        report_.levels.push_back(level);
+        frontier = std::move(next_frontier);
+        counts = std::move(next_counts);
+        if (hierarchical) priors = std::move(child_priors);
+    }
+
+    report_.total_wall_seconds = wallSeconds() - fit_start;
+    report_.aggregateThreads();
+
+    // Binned data and row indices are only needed during training
+    binned_.releaseBins();
+    row_index_.clear();
+    row_index_.shrink_to_fit();
+    row_scratch_.clear();
+    row_scratch_.shrink_to_fit();
+}
+
+template <typename Count>
+BayesTree::SplitResult BayesTree::processNode(const FrontierNode& frontier, int depth,
+                                              const std::vector<int>& y,
+                                              const double* sample_weight, const Count* counts,
+                                              const LevelPriors& priors,
+                                              const LevelPriors& child_priors,
+                                              std::size_t child_row,
+                                              ThreadReport& thread_report) {
+    constexpr bool weighted = std::is_same_v<Count, double>;
+    const int* rows_begin = row_index_.data() + frontier.begin;
+    const int* rows_end = row_index_.data() + frontier.end;
+    const int n = frontier.end - frontier.begin;
+    const int K = num_classes_;
+
+    SplitResult result;
+    BAYES_TREE_PROFILE_ADD(thread_report.nodes_processed, 1);
+
+    if (depth >= params_.max_depth || n < 2 * params_.min_samples_leaf)
+        return result;
+
+    // Class-count histogram per (feature, bin), including the missing bin
+    std::vector<std::size_t> offsets(num_features_ + 1, 0);
+    for (int f = 0; f < num_features_; ++f)
+        offsets[f + 1] = offsets[f] + (binned_.numBins(f) + binned_.hasMissing(f)) * K;
+
+    // Weighted histograms hold class weights, so rows per bin (needed for
+    // min_samples_leaf and to skip empty bins) are counted alongside
+    std::vector<Count> hist(offsets.back(), 0);
+    std::vector<int> bin_rows(weighted ? offsets.back() / K : 0, 0);
+    {
+        BAYES_TREE_PROFILE_PHASE(thread_report, Histogram);
+        for (int f = 0; f < num_features_; ++f) {
+            const Bin* col = binned_.column(f);
+            Count* h = hist.data() + offsets[f];
+            if constexpr (weighted) {
+                int* rows = bin_rows.data() + offsets[f] / K;
+                for (const int* r = rows_begin; r != rows_end; ++r) {
+                    h[col[*r] * K + y[*r]] += sample_weight[*r];
+                    ++rows[col[*r]];
+                }
+            } else {
+                for (const int* r = rows_begin; r != rows_end; ++r) ++h[col[*r] * K + y[*r]];
+            }
+        }
+        BAYES_TREE_PROFILE_ADD(result.bytes_touched,
+            static_cast<std::uint64_t>(n) * (num_features_ * (sizeof(Bin) + sizeof(Count)) + sizeof(int)
+                                             + (weighted ? sizeof(double) : 0))
+            + hist.size() * sizeof(Count) + bin_rows.size() * sizeof(int));
+    }
+
+    {
+        BAYES_TREE_PROFILE_PHASE(thread_report, SplitScoring);
+        const double parent_ll = priors.logMarginalLikelihood(frontier.prior_row, counts);
+        BAYES_TREE_PROFILE_ADD(thread_report.likelihood_evaluations, 1);
+
+        // Categories are scanned in order of the posterior mean of the
+        // node's majority class under the child prior, which puts the
+        // best binary partition among the C - 1 prefixes (exact for K = 2)
+        const int majority = static_cast<int>(std::max_element(counts, counts + K) - counts);
+        const double majority_alpha = child_priors.row(child_row)[majority];
+        const double child_alpha_total = child_priors.totals[child_row];
+        const int min_leaf = std::max(1, params_.min_samples_leaf);
+
+        // Slack for rounding differences between bounds and exact scores,
+        // so that pruning never drops a candidate the full scan would pick.
+        // It scales with the size of the lgamma terms, about N log N.
+        double n_total = 0.0;
+        for (int k = 0; k < K; ++k) n_total += counts[k];
+        const double margin = 1e-10 * (1.0 + std::abs(parent_ll) + n_total * std::log(2.0 + n_total));
+
+        struct Cut {
+            int step;    // Last scan step sent left
+            int n_left;  // Rows sent left, missing rows excluded
+        };
+        std::vector<Count> left(K), right(K), missing(K), candidate(K), upper(K);
+        std::vector<int> order;
+        std::vector<double> mean(256);
+        std::vector<Cut> cuts;
+        std::vector<Count> prefix;
+        std::vector<std::pair<int, int>> ranges;
+        double best_gain = params_.min_gain;
+        for (int f = 0; f < num_features_; ++f) {
+            const int num_bins = binned_.numBins(f);
+            const bool categorical = binned_.isCategorical(f);
+            const Count* h = hist.data() + offsets[f];
+            const auto rows_in_bin = [&](int b) {
+                if constexpr (weighted) {
+                    return bin_rows[offsets[f] / K + b];
+                } else {
+                    int total = 0;
+                    for (int k = 0; k < K; ++k) total += h[b * K + k];
+                    return total;
+                }
+            };
+
+            // Rows with a missing value are tried on both sides of every cut
+            int n_missing = 0;
+            std::fill(missing.begin(), missing.end(), 0);
+            if (binned_.hasMissing(f)) {
+                for (int k = 0; k < K; ++k) missing[k] = h[num_bins * K + k];
+                n_missing = rows_in_bin(num_bins);
+            }
+
+            int num_steps = num_bins;
+            if (categorical) {
+                order.clear();
+                for (int c = 0; c < num_bins; ++c) {
+                    if (rows_in_bin(c) == 0) continue;
+                    Count bin_total = 0;
+                    for (int k = 0; k < K; ++k) bin_total += h[c * K + k];
+                    order.push_back(c);
+                    mean[c] = (majority_alpha + h[c * K + majority]) / (child_alpha_total + bin_total);
+                }
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return mean[a] < mean[b]; });
+                num_steps = static_cast<int>(order.size());
+            }
+
+            // Valid cuts in scan order: cut c sends the bins of steps
+            // [0, cuts[c].step] left, with class counts prefix[c * K, (c + 1) * K)
+            cuts.clear();
+            prefix.clear();
+            std::fill(left.begin(), left.end(), 0);
+            int n_left = 0;
+            for (int i = 0; i < num_steps; ++i) {
+                const int b = categorical ? order[i] : i;
+                for (int k = 0; k < K; ++k) left[k] += h[b * K + k];
+                const int bin_total = rows_in_bin(b);
+                n_left += bin_total;
+                if (bin_total == 0) continue;  // Same partition as the previous bin
+                if (n - n_left < min_leaf) break;
+                cuts.push_back({i, n_left});
+                prefix.insert(prefix.end(), left.begin(), left.end());
+            }
+            const int num_cuts = static_cast<int>(cuts.size());
+
+            // Candidates of one cut: missing rows right, then left
+            const auto num_candidates = [&](int c) {
+                int num = 0;
+                for (int missing_left = 0; missing_left <= (n_missing > 0); ++missing_left) {
+                    const int n_candidate = cuts[c].n_left + (missing_left ? n_missing : 0);
+                    num += n_candidate >= min_leaf && n - n_candidate >= min_leaf;
+                }
+                return num;
+            };
+            const auto score_cut = [&](int c) {
+                const Count* cut_left = prefix.data() + std::size_t(c) * K;
+                for (int missing_left = 0; missing_left <= (n_missing > 0); ++missing_left) {
+                    const int n_candidate = cuts[c].n_left + (missing_left ? n_missing : 0);
+                    if (n_candidate < min_leaf || n - n_candidate < min_leaf) continue;
+
+                    for (int k = 0; k < K; ++k) {
+                        candidate[k] = cut_left[k] + (missing_left ? missing[k] : 0);
+                        right[k] = counts[k] - candidate[k];
+                    }
+                    const double gain = child_priors.logMarginalLikelihood(child_row, candidate.data())
+                                      + child_priors.logMarginalLikelihood(child_row, right.data())
+                                      - parent_ll;
+                    BAYES_TREE_PROFILE_ADD(thread_report.candidate_splits_scored, 1);
+                    BAYES_TREE_PROFILE_ADD(thread_report.likelihood_evaluations, 2);
+
+                    if (gain > best_gain) {
+                        const int step = cuts[c].step;
+                        best_gain = gain;
+                        result.split = true;
+                        result.feature = f;
+                        result.bin = categorical ? order[step] : step;
+                        result.categorical = categorical;
+                        result.missing_left = missing_left;
+                        result.left_bins.reset();
+                        if (categorical) {
+                            for (int i = 0; i <= step; ++i) result.left_bins.set(order[i]);
+                        }
+                        result.gain = gain;
+                        result.left_counts.assign(candidate.begin(), candidate.end());
+                    }
+                }
+            };
+
+            if (!params_.prune_splits) {
+                for (int c = 0; c < num_cuts; ++c) score_cut(c);
+                continue;
+            }
+
+            // Branch and bound over ranges of cuts. The left counts of every
+            // candidate in [lo, hi) lie between prefix[lo] and prefix[hi - 1]
+            // plus the missing rows, so a range whose bound cannot beat the
+            // best gain is skipped whole; otherwise it is halved. Ranges are
+            // visited left to right, so ties resolve as in the full scan.
+            ranges.assign(1, {0, num_cuts});
+            while (!ranges.empty()) {
+                const auto [lo, hi] = ranges.back();
+                ranges.pop_back();
+                if (hi - lo <= kExactCutRange) {
+                    for (int c = lo; c < hi; ++c) score_cut(c);
+                    continue;
+                }
+
+                const Count* lo_counts = prefix.data() + std::size_t(lo) * K;
+                const Count* hi_prefix = prefix.data() + std::size_t(hi - 1) * K;
+                for (int k = 0; k < K; ++k) upper[k] = hi_prefix[k] + missing[k];
+                const double bound = child_priors.splitUpperBound(child_row, counts, lo_counts, upper.data())
+                                   - parent_ll;
+                BAYES_TREE_PROFILE_ADD(thread_report.split_bounds_evaluated, 1);
+
+                if (bound + margin < best_gain) {
+                    int skipped = 0;
+                    for (int c = lo; c < hi; ++c) skipped += num_candidates(c);
+                    BAYES_TREE_PROFILE_ADD(thread_report.candidate_splits_pruned, skipped);
+                    BAYES_TREE_PROFILE_ADD(thread_report.features_pruned, lo == 0 && hi == num_cuts);
+                    continue;
+                }
+                const int mid = lo + (hi - lo) / 2;
+                ranges.push_back({mid, hi});
+                ranges.push_back({lo, mid});
+            }
+        }
+    }
+
+    if (!result.split) return result;
+
+    {
+        BAYES_TREE_PROFILE_PHASE(thread_report, Partition);
+        const int num_bins = binned_.numBins(result.feature);
+        std::array<std::uint8_t, 256> goes_left{};
+        for (int b = 0; b < num_bins; ++b)
+            goes_left[b] = result.categorical ? result.left_bins[b] : b <= result.bin;
+        if (binned_.hasMissing(result.feature)) goes_left[num_bins] = result.missing_left;
+        result.split_point = partitionRows(frontier.begin, frontier.end, result.feature, goes_left);
+        BAYES_TREE_PROFILE_ADD(result.bytes_touched,
+            static_cast<std::uint64_t>(n) * (sizeof(Bin) + 3 * sizeof(int))
+            + static_cast<std::uint64_t>(frontier.end - result.split_point) * 2 * sizeof(int));
+    }
+
+    return result;
+}
+
+// Batched prior propagation for one level: the children of frontier[i]
+// get concentration * (posterior mean of frontier[i]) as their prior,
+// written to row i of child_priors. Both children share the row.
+template <typename Count>
+void BayesTree::deriveChildPriors(const std::vector<FrontierNode>& frontier,
+                                  const std::vector<Count>& counts, const LevelPriors& priors,
+                                  LevelPriors& child_priors) const {
+    const int K = num_classes_;
+    const double concentration =
+        params_.prior_concentration > 0.0 ? params_.prior_concentration : 0.5 * K;
+
+    child_priors.resize(frontier.size(), K);
+    for (std::size_t i = 0; i < frontier.size(); ++i) {
+        const std::size_t p = frontier[i].prior_row;
+        const double* parent = priors.row(p);
+        const Count* c = counts.data() + i * K;
+        double n = 0.0;
+        for (int k = 0; k < K; ++k) n += c[k];
+        const double scale = concentration / (priors.totals[p] + n);
+
+        double* out = child_priors.alphas.data() + i * K;
+        for (int k = 0; k < K; ++k) out[k] = scale * (parent[k] + c[k]);
+    }
+    child_priors.computeTerms();
+}
+
+void BayesTree::LevelPriors::resize(std::size_t rows, int K) {
+    num_classes = K;
+    alphas.assign(rows * K, 0.0);
+    lgamma_alphas.assign(rows * K, 0.0);
+    totals.assign(rows, 0.0);
+    lgamma_totals.assign(rows, 0.0);
+    lattice.assign(rows, 0);
+}
+
+std::size_t BayesTree::LevelPriors::numRows() const {
+    return totals.size();
+}
+
+const double* BayesTree::LevelPriors::row(std::size_t r) const {
+    return alphas.data() + r * num_classes;
+}
+
+// Rows whose alphas are all half-integers (Jeffreys, symmetric integer
+// priors) use the lgamma table; derived shrinkage priors generally do not.
+void BayesTree::LevelPriors::computeTerms() {
+    const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+    const int K = num_classes;
+    for (std::size_t r = 0; r < numRows(); ++r) {
+        const double* a = row(r);
+        double* lg = lgamma_alphas.data() + r * K;
+
+        double total = 0.0;
+        bool on_lattice = true;
+        for (int k = 0; k < K; ++k) {
+            total += a[k];
+            on_lattice = on_lattice && HalfIntegerLgammaTable::twiceIfLattice(a[k]) > 0;
+        }
+        for (int k = 0; k < K; ++k)
+            lg[k] = on_lattice ? lgamma_half(static_cast<long>(2.0 * a[k])) : std::lgamma(a[k]);
+
+        totals[r] = total;
+        lgamma_totals[r] = on_lattice ? lgamma_half(static_cast<long>(2.0 * total)) : std::lgamma(total);
+        lattice[r] = on_lattice;
+    }
+}
+
+// Dirichlet-multinomial log marginal likelihood of counts under row r.
+// Categories with zero count contribute nothing, so only observed ones are
+// visited; the prior-only lgamma terms come from the cache.
+double BayesTree::LevelPriors::logMarginalLikelihood(std::size_t r, const int* counts) const {
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    const int K = num_classes;
+    const double* a = row(r);
+    const double* lg = lgamma_alphas.data() + r * K;
+
+    double log_likelihood = 0.0;
+    long count_total = 0;
+    if (lattice[r]) {
+        const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+        for (int k = 0; k < K; ++k) {
+            if (counts[k] == 0) continue;
+            log_likelihood += lgamma_half(2L * counts[k] + static_cast<long>(2.0 * a[k])) - lg[k];
+            count_total += counts[k];
+        }
+        return log_likelihood + (lgamma_totals[r]
+            - lgamma_half(2L * count_total + static_cast<long>(2.0 * totals[r])));
+    }
+
+    for (int k = 0; k < K; ++k) {
+        if (counts[k] == 0) continue;
+        log_likelihood += std::lgamma(counts[k] + a[k]) - lg[k];
+        count_total += counts[k];
+    }
+    return log_likelihood + (lgamma_totals[r] - std::lgamma(count_total + totals[r]));
+}
+
+// Weighted counts are real, so every lgamma goes through libm; the cached
+// prior-only terms are shared with the integer overload
+double BayesTree::LevelPriors::logMarginalLikelihood(std::size_t r, const double* counts) const {
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    const int K = num_classes;
+    const double* a = row(r);
+    const double* lg = lgamma_alphas.data() + r * K;
+
+    double log_likelihood = 0.0;
+    double count_total = 0.0;
+    for (int k = 0; k < K; ++k) {
+        if (counts[k] <= 0.0) continue;
+        log_likelihood += std::lgamma(counts[k] + a[k]) - lg[k];
+        count_total += counts[k];
+    }
+    return log_likelihood + (lgamma_totals[r] - std::lgamma(count_total + totals[r]));
+}
+
+// Upper bound on logMarginalLikelihood(left) + logMarginalLikelihood(total
+// - left) over every left with lo <= left <= hi per class. Up to constants
+// the score is sum_k phi_k(l_k) - psi(m), with phi_k(l) = lgamma(l + a_k) +
+// lgamma(t_k - l + a_k) and psi(m) = lgamma(m + A) + lgamma(N - m + A) for
+// the left total m. Both are convex, so for any lambda
+//   score <= sum_k max over {lo_k, hi_k} of (phi_k(l) - lambda l)
+//            - min over m in [sum lo, sum hi] of (psi(m) - lambda m).
+// lambda = 0 puts the minimum of psi at the point nearest N / 2. lambda =
+// psi'(mid) puts it at the midpoint mid of the range, and makes the class
+// terms nearly flat when the classes are mixed alike on both sides, which
+// is the common case for uninformative cuts. The smaller bound is returned.
+template <typename Count>
+double BayesTree::LevelPriors::splitUpperBound(std::size_t r, const Count* total, const Count* lo,
+                                               const Count* hi) const {
+    const int K = num_classes;
+    const double* a = row(r);
+    const double* lg = lgamma_alphas.data() + r * K;
+    const bool table = std::is_same_v<Count, int> && lattice[r];
+    const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+
+    // lgamma(x + alpha) - lgamma(alpha); x is a count or half an integer total
+    const auto term = [&](double x, double alpha, double lgamma_alpha) {
+        if (x <= 0.0) return 0.0;
+        if (table) return lgamma_half(static_cast<long>(2.0 * x + 2.0 * alpha)) - lgamma_alpha;
+        return std::lgamma(x + alpha) - lgamma_alpha;
+    };
+
+    double n_lo = 0.0, n_hi = 0.0, n = 0.0;
+    for (int k = 0; k < K; ++k) {
+        n_lo += lo[k];
+        n_hi += hi[k];
+        n += total[k];
+    }
+    const double A = totals[r];
+    const auto psi = [&](double m) {
+        return term(m, A, lgamma_totals[r]) + term(n - m, A, lgamma_totals[r]);
+    };
+    const double mid = 0.5 * (n_lo + n_hi);
+    const double lambda = digamma(mid + A) - digamma(n - mid + A);
+
+    double flat = 0.0;    // lambda = 0
+    double tilted = 0.0;  // lambda = psi'(mid)
+    for (int k = 0; k < K; ++k) {
+        const double t = total[k];
+        if (t <= 0.0) continue;
+        const double at_lo = term(lo[k], a[k], lg[k]) + term(t - lo[k], a[k], lg[k]);
+        const double at_hi = term(hi[k], a[k], lg[k]) + term(t - hi[k], a[k], lg[k]);
+        flat += std::max(at_lo, at_hi);
+        tilted += std::max(at_lo - lambda * lo[k], at_hi - lambda * hi[k]);
+    }
+    flat -= psi(std::clamp(0.5 * n, n_lo, n_hi));
+    tilted -= psi(mid) - lambda * mid;
+    return std::min(flat, tilted);
+}
+
+// Stable in-place partition of row_index_[begin, end) by goes_left[bin].
+// Returns the split point. Rows going left are compacted in place (the write
+// cursor never overtakes the read cursor), rows going right are compacted
+// into the matching range of row_scratch_ and copied back behind them. Both
+// cursors advance by the predicate value, so the loop has no data-dependent
+// branch. Ranges of different nodes are disjoint, so nodes can be
+// partitioned concurrently.
+int BayesTree::partitionRows(int begin, int end, int feature,
+                             const std::array<std::uint8_t, 256>& goes_left_table) {
+    const Bin* col = binned_.column(feature);
+    int* rows = row_index_.data() + begin;
+    int* right = row_scratch_.data() + begin;
+    const int n = end - begin;
+
+    int n_left = 0;
+    int n_right = 0;
+    for (int i = 0; i < n; ++i) {
+        const int r = rows[i];
+        const int goes_left = goes_left_table[col[r]];
+        rows[n_left] = r;
+        right[n_right] = r;
+        n_left += goes_left;
+        n_right += 1 - goes_left;
+    }
+    std::copy(right, right + n_right, rows + n_left);
+    return begin + n_left;
+}
+
+const Node& BayesTree::findLeaf(const std::vector<double>& x) const {
+    if (nodes_.empty())
+        throw std::logic_error("BayesTree has not been fitted");
+    if (static_cast<int>(x.size()) != num_features_)
+        throw std::invalid_argument("Input dimension mismatch");
+
+    int index = 0;
+    while (!nodes_[index].isLeaf()) {
+        const Node& node = nodes_[index];
+        const double v = x[node.feature];
+        bool go_left;
+        if (std::isnan(v))
+            go_left = node.missing_left;
+        else if (node.categorical)
+            go_left = v >= 0.0 && v < 256.0 && node.left_categories.test(static_cast<std::size_t>(v))
+                   && v == std::floor(v);
+        else
+            go_left = v <= node.threshold;
+        index = go_left ? node.left : node.right;
+    }
+    return nodes_[index];
+}
+
+std::vector<double> BayesTree::predictProba(const std::vector<double>& x) const {
+    const auto& alphas = findLeaf(x).posterior_alphas;
+    double total = 0.0;
+    for (double a : alphas) total += a;
+
+    std::vector<double> probs(alphas.size());
+    for (std::size_t k = 0; k < alphas.size(); ++k) probs[k] = alphas[k] / total;
+    return probs;
+}
+
+std::vector<std::vector<double>> BayesTree::predictProba(const FeatureMatrix& X) const {
+    std::vector<std::vector<double>> out;
+    out.reserve(X.size());
+    for (const auto& row : X) out.push_back(predictProba(row));
+    return out;
+}
+
+int BayesTree::predictClass(const std::vector<double>& x) const {
+    const auto& alphas = findLeaf(x).posterior_alphas;
+    return static_cast<int>(std::max_element(alphas.begin(), alphas.end()) - alphas.begin());
+}
+
+// Accessors
+bool BayesTree::isFitted() const {
+    return !nodes_.empty();
+}
+
+int BayesTree::getNumClasses() const {
+    return num_classes_;
+}
+
+int BayesTree::getNumFeatures() const {
+    return num_features_;
+}
+
+std::size_t BayesTree::getNumNodes() const {
+    return nodes_.size();
+}
+
+std::size_t BayesTree::getNumLeaves() const {
+    return std::count_if(nodes_.begin(), nodes_.end(), [](const Node& n) { return n.isLeaf(); });
+}
+
+int BayesTree::getDepth() const {
+    int depth = 0;
+    for (const auto& n : nodes_) depth = std::max(depth, n.depth);
+    return depth;
+}
+
+const std::vector<Node>& BayesTree::getNodes() const {
+    return nodes_;
+}
+
+const BayesTreeParams& BayesTree::getParams() const {
+    return params_;
+}
+
+const TrainingReport& BayesTree::getTrainingReport() const {
+    return report_;
+}
@@ -0,0 +1,126 @@
+#include "bayes_tree/binned_data.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+BinnedData::BinnedData() = default;
+
+BinnedData::BinnedData(const FeatureMatrix& X, int max_bins,
+                       const std::vector<int>& categorical_features) {
+    if (X.empty())
+        throw std::invalid_argument("Training data cannot be empty");
+    if (max_bins < 2 || max_bins > 256)
+        throw std::invalid_argument("max_bins must be in [2, 256]");
+
+    num_rows_ = static_cast<int>(X.size());
+    num_features_ = static_cast<int>(X[0].size());
+    for (const auto& row : X) {
+        if (static_cast<int>(row.size()) != num_features_)
+            throw std::invalid_argument("All rows of X must have the same length");
+    }
+
+    categorical_.assign(num_features_, 0);
+    for (int f : categorical_features) {
+        if (f < 0 || f >= num_features_)
+            throw std::invalid_argument("Categorical feature index out of range");
+        categorical_[f] = 1;
+    }
+
+    edges_.assign(num_features_, {});
+    num_bins_.assign(num_features_, 1);
+    has_missing_.assign(num_features_, 0);
+    bins_.resize(static_cast<std::size_t>(num_features_) * num_rows_);
+
+    std::vector<double> column;
+    column.reserve(num_rows_);
+    for (int f = 0; f < num_features_; ++f) {
+        Bin* out = bins_.data() + static_cast<std::size_t>(f) * num_rows_;
+        column.clear();
+        for (int i = 0; i < num_rows_; ++i) {
+            if (!std::isnan(X[i][f])) column.push_back(X[i][f]);
+        }
+        const int num_values = static_cast<int>(column.size());
+        has_missing_[f] = num_values < num_rows_;
+
+        if (categorical_[f]) {
+            int max_code = 0;
+            for (double v : column) {
+                if (v < 0.0 || v > 254.0 || v != std::floor(v))
+                    throw std::invalid_argument("Categorical values must be integers in [0, 254]");
+                max_code = std::max(max_code, static_cast<int>(v));
+            }
+            num_bins_[f] = max_code + 1;
+            for (int i = 0; i < num_rows_; ++i)
+                out[i] = std::isnan(X[i][f]) ? static_cast<Bin>(num_bins_[f]) : static_cast<Bin>(X[i][f]);
+            continue;
+        }
+
+        // Leave room for the missing bin
+        const int value_bins = has_missing_[f] ? std::min(max_bins, 255) : max_bins;
+        std::sort(column.begin(), column.end());
+
+        auto& edges = edges_[f];
+        for (int b = 1; b < value_bins; ++b) {
+            const std::size_t pos = static_cast<std::size_t>(b) * num_values / value_bins;
+            if (pos == 0) continue;
+
+            // Never place an edge between equal values: move up to the next distinct one
+            const double lo = column[pos - 1];
+            auto hi = std::upper_bound(column.begin() + pos - 1, column.end(), lo);
+            if (hi == column.end()) break;
+
+            const double edge = 0.5 * (lo + *hi);
+            if (edges.empty() || edge > edges.back()) edges.push_back(edge);
+        }
+        num_bins_[f] = static_cast<int>(edges.size()) + 1;
+
+        for (int i = 0; i < num_rows_; ++i) out[i] = binValue(f, X[i][f]);
+    }
+}
+
+int BinnedData::numRows() const {
+    return num_rows_;
+}
+
+int BinnedData::numFeatures() const {
+    return num_features_;
+}
+
+int BinnedData::numBins(int feature) const {
+    return num_bins_[feature];
+}
+
+bool BinnedData::isCategorical(int feature) const {
+    return categorical_[feature] != 0;
+}
+
+bool BinnedData::hasMissing(int feature) const {
+    return has_missing_[feature] != 0;
+}
+
+int BinnedData::missingBin(int feature) const {
+    return num_bins_[feature];
+}
+
+const BinnedData::Bin* BinnedData::column(int feature) const {
+    return bins_.data() + static_cast<std::size_t>(feature) * num_rows_;
+}
+
+double BinnedData::threshold(int feature, int bin) const {
+    return edges_[feature][bin];
+}
+
+const std::vector<double>& BinnedData::edges(int feature) const {
+    return edges_[feature];
+}
+
+BinnedData::Bin BinnedData::binValue(int feature, double x) const {
+    if (std::isnan(x)) return static_cast<Bin>(missingBin(feature));
+    const auto& edges = edges_[feature];
+    return static_cast<Bin>(std::lower_bound(edges.begin(), edges.end(), x) - edges.begin());
+}
+
+void BinnedData::releaseBins() {
+    bins_.clear();
+    bins_.shrink_to_fit();
+}
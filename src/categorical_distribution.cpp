@@ -1,12 +1,14 @@
 #include "bayes_tree/categorical_distribution.hpp"
+#include "bayes_tree/instrumentation.hpp"
 #include <vector>
 #include <cmath>
 #include <stdexcept>
 #include <numeric>
-#include <iostream>
+#include <cassert>
 
 CategoricalDistribution::CategoricalDistribution(const std::vector<double>& probs) {
-    std::cout << "Constructor called\n";
+    BAYES_TREE_COUNT(CategoricalConstructions);
+    BAYES_TREE_TRACE("CategoricalDistribution", "construct", this);
 
     set_probs(probs);
     // if (probs.empty())
@@ -26,6 +28,16 @@ void CategoricalDistribution::set_probs(const std::vector<double>& probs) {
 }
 
 
+// Unchecked variant for trusted callers (e.g. posterior means that are
+// already known to be positive and of the right length)
+void CategoricalDistribution::set_probs_unchecked(const std::vector<double>& probs) {
+    assert(!probs.empty() && "Probability vector cannot be empty.");
+
+    probabilities_ = probs;
+    normalise_unchecked();
+}
+
+
 // Normalizes the probability vector to sum to 1
 void CategoricalDistribution::normalise() {
     double sum = std::accumulate(probabilities_.begin(), probabilities_.end(), 0.0);
@@ -36,6 +48,14 @@ void CategoricalDistribution::normalise() {
         p /= sum;
 }
 
+void CategoricalDistribution::normalise_unchecked() {
+    double sum = std::accumulate(probabilities_.begin(), probabilities_.end(), 0.0);
+    assert(sum > 0.0 && "Sum of probabilities must be positive.");
+
+    for (auto& p : probabilities_)
+        p /= sum;
+}
+
 // Return probabilities
 const std::vector<double>& CategoricalDistribution::probs() const {
     return probabilities_;
@@ -46,6 +66,15 @@ double CategoricalDistribution::log_likelihood(const std::vector<int>& counts) c
     if (counts.size() != probabilities_.size())
         throw std::invalid_argument("Counts and probability vectors must be same length.");
 
+    return log_likelihood_unchecked(counts);
+}
+
+// Same as log_likelihood() but without the length check
+double CategoricalDistribution::log_likelihood_unchecked(const std::vector<int>& counts) const {
+    assert(counts.size() == probabilities_.size() &&
+           "Counts and probability vectors must be same length.");
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+
     double loglike = 0.0;
     for (size_t i = 0; i < counts.size(); ++i) {
         if (probabilities_[i] <= 0.0 && counts[i] > 0)
@@ -0,0 +1,353 @@
+#include "bayes_tree/codegen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace {
+
+// Exact round-trip spelling of a double (hex float literal). Missing-only
+// splits store a +inf threshold, which %a would print as a bare "inf".
+std::string hexDouble(double value) {
+    if (std::isinf(value))
+        return value > 0 ? "std::numeric_limits<double>::infinity()"
+                         : "-std::numeric_limits<double>::infinity()";
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%a", value);
+    return buffer;
+}
+
+// One tree of the store, with tree-local node indices [0, num_nodes)
+struct TreeView {
+    const std::int32_t* feature;
+    const double* threshold;
+    const std::int32_t* left;
+    const std::int32_t* right;
+    const std::uint8_t* missing_left;
+    int num_nodes;
+};
+
+int treeDepth(const TreeView& tree, int node) {
+    if (tree.feature[node] < 0) return 0;
+    return 1 + std::max(treeDepth(tree, tree.left[node]), treeDepth(tree, tree.right[node]));
+}
+
+void emitNested(std::ostream& out, const TreeView& tree, const std::vector<int>& leaf_of,
+                int t, int node, int indent) {
+    const std::string pad(indent * 4, ' ');
+    if (tree.feature[node] < 0) {
+        out << pad << "return kLeaves" << t << '[' << leaf_of[node] << "];\n";
+        return;
+    }
+    const std::string x = "x[" + std::to_string(tree.feature[node]) + "]";
+    out << pad << "if (" << x << " <= " << hexDouble(tree.threshold[node]);
+    if (tree.missing_left[node]) out << " || std::isnan(" << x << ")";
+    out << ") {\n";
+    emitNested(out, tree, leaf_of, t, tree.left[node], indent + 1);
+    out << pad << "} else {\n";
+    emitNested(out, tree, leaf_of, t, tree.right[node], indent + 1);
+    out << pad << "}\n";
+}
+
+template <typename T, typename Fn>
+void emitArray(std::ostream& out, const char* type, const std::string& name,
+               const std::vector<T>& values, Fn format) {
+    out << "constexpr " << type << ' ' << name << '[' << values.size() << "] = {";
+    for (std::size_t i = 0; i < values.size(); ++i) out << (i ? ", " : "") << format(values[i]);
+    out << "};\n";
+}
+
+// Tree t as a function from a feature row to its leaf's class probabilities.
+// Shallow trees take exactly `depth` select steps over node arrays in which
+// leaves point back to themselves, so the walk has no data-dependent branch.
+void emitTree(std::ostream& out, const SampledTreeStore& store, const TreeView& tree,
+              const double* leaf_probs, int t, const CodegenParams& params) {
+    const int K = store.getNumClasses();
+
+    std::vector<int> leaf_of(tree.num_nodes, 0);
+    std::vector<std::int32_t> leaf_slots;
+    for (int node = 0; node < tree.num_nodes; ++node) {
+        if (tree.feature[node] >= 0) continue;
+        leaf_of[node] = static_cast<int>(leaf_slots.size());
+        leaf_slots.push_back(tree.left[node]);
+    }
+
+    out << "constexpr double kLeaves" << t << '[' << leaf_slots.size() << "][" << K << "] = {\n";
+    for (std::int32_t slot : leaf_slots) {
+        out << "    {";
+        for (int k = 0; k < K; ++k)
+            out << (k ? ", " : "") << hexDouble(leaf_probs[static_cast<std::size_t>(slot) * K + k]);
+        out << "},\n";
+    }
+    out << "};\n";
+
+    const int depth = treeDepth(tree, 0);
+    if (depth <= params.max_branchless_depth) {
+        std::vector<int> feature(tree.num_nodes), left(tree.num_nodes), right(tree.num_nodes);
+        std::vector<int> missing_left(tree.num_nodes);
+        std::vector<double> threshold(tree.num_nodes);
+        bool any_missing_left = false;
+        for (int node = 0; node < tree.num_nodes; ++node) {
+            const bool leaf = tree.feature[node] < 0;
+            feature[node] = leaf ? 0 : tree.feature[node];
+            threshold[node] = leaf ? 0.0 : tree.threshold[node];
+            left[node] = leaf ? node : tree.left[node];
+            right[node] = leaf ? node : tree.right[node];
+            missing_left[node] = !leaf && tree.missing_left[node];
+            any_missing_left = any_missing_left || missing_left[node];
+        }
+        const auto as_int = [](int v) { return std::to_string(v); };
+        const std::string suffix = std::to_string(t);
+        emitArray(out, "int", "kFeature" + suffix, feature, as_int);
+        emitArray(out, "double", "kThreshold" + suffix, threshold, hexDouble);
+        emitArray(out, "int", "kLeft" + suffix, left, as_int);
+        emitArray(out, "int", "kRight" + suffix, right, as_int);
+        emitArray(out, "int", "kLeafOf" + suffix, leaf_of, as_int);
+        // Only trees that send some NaN left pay for the extra test
+        if (any_missing_left) {
+            emitArray(out, "bool", "kMissingLeft" + suffix, missing_left,
+                      [](int v) { return std::string(v ? "true" : "false"); });
+        }
+
+        out << "inline const double* tree" << t << "(const double* x) {\n"
+            << "    int n = 0;\n";
+        if (any_missing_left) {
+            out << "    for (int step = 0; step < " << depth << "; ++step) {\n"
+                << "        const double v = x[kFeature" << t << "[n]];\n"
+                << "        n = v <= kThreshold" << t << "[n] || (kMissingLeft" << t << "[n] && std::isnan(v))"
+                << " ? kLeft" << t << "[n] : kRight" << t << "[n];\n"
+                << "    }\n";
+        } else {
+            out << "    for (int step = 0; step < " << depth << "; ++step)\n"
+                << "        n = x[kFeature" << t << "[n]] <= kThreshold" << t << "[n] ? kLeft" << t
+                << "[n] : kRight" << t << "[n];\n";
+        }
+        out << "    return kLeaves" << t << "[kLeafOf" << t << "[n]];\n"
+            << "}\n\n";
+    } else {
+        out << "inline const double* tree" << t << "(const double* x) {\n";
+        emitNested(out, tree, leaf_of, t, 0, 1);
+        out << "}\n\n";
+    }
+}
+
+}  // namespace
+
+std::string generateModelSource(const SampledTreeStore& store, int num_features,
+                                const CodegenParams& params) {
+    if (store.numTrees() == 0)
+        throw std::invalid_argument("Cannot generate code for an empty store");
+    if (store.getLeafFormat() != LeafFormat::Double)
+        throw std::invalid_argument("Code generation needs Double leaves");
+    if (num_features < 1)
+        throw std::invalid_argument("num_features must be positive");
+
+    const auto& offsets = store.getTreeOffsets();
+    const auto& weights = store.getWeights();
+    const int K = store.getNumClasses();
+    const int num_trees = static_cast<int>(offsets.size());
+    const int total_nodes = static_cast<int>(store.getFeatures().size());
+
+    std::ostringstream out;
+    out << "// Generated by bayes_tree codegen; do not edit.\n"
+        << "// " << num_trees << " trees, " << K << " classes, " << num_features << " features.\n"
+        << "#include <cmath>\n"
+        << "#include <cstddef>\n"
+        << "#include <limits>\n\n"
+        << "namespace {\n\n"
+        << "constexpr int kNumClasses = " << K << ";\n"
+        << "constexpr int kNumFeatures = " << num_features << ";\n\n";
+
+    for (int t = 0; t < num_trees; ++t) {
+        const int begin = static_cast<int>(offsets[t]);
+        const int end = t + 1 < num_trees ? static_cast<int>(offsets[t + 1]) : total_nodes;
+        const TreeView tree{store.getFeatures().data() + begin, store.getThresholds().data() + begin,
+                            store.getLeft().data() + begin, store.getRight().data() + begin,
+                            store.getMissingLeft().data() + begin, end - begin};
+        for (int node = 0; node < tree.num_nodes; ++node) {
+            if (tree.feature[node] >= num_features)
+                throw std::invalid_argument("Tree splits on a feature beyond num_features");
+        }
+        emitTree(out, store, tree, store.getLeafProbs().data(), t, params);
+    }
+
+    // Same accumulation order as SampledTreeStore::predictProba
+    std::uint64_t total_weight = 0;
+    for (std::uint32_t w : weights) total_weight += w;
+
+    out << "inline void accumulate(double* probs, double w, const double* leaf) {\n"
+        << "    for (int k = 0; k < kNumClasses; ++k) probs[k] += w * leaf[k];\n"
+        << "}\n\n"
+        << "}  // namespace\n\n"
+        << "extern \"C\" {\n\n"
+        << "int bayes_tree_abi_version(void) { return " << kCompiledModelAbiVersion << "; }\n"
+        << "int bayes_tree_num_classes(void) { return kNumClasses; }\n"
+        << "int bayes_tree_num_features(void) { return kNumFeatures; }\n\n"
+        << "void bayes_tree_predict_proba(const double* x, double* probs) {\n"
+        << "    for (int k = 0; k < kNumClasses; ++k) probs[k] = 0.0;\n";
+    for (int t = 0; t < num_trees; ++t)
+        out << "    accumulate(probs, " << hexDouble(static_cast<double>(weights[t])) << ", tree" << t << "(x));\n";
+    out << "    const double inv_total = " << hexDouble(1.0 / static_cast<double>(total_weight)) << ";\n"
+        << "    for (int k = 0; k < kNumClasses; ++k) probs[k] *= inv_total;\n"
+        << "}\n\n"
+        << "void bayes_tree_predict_proba_batch(const double* X, std::size_t num_rows, double* probs) {\n"
+        << "    for (std::size_t i = 0; i < num_rows; ++i)\n"
+        << "        bayes_tree_predict_proba(X + i * kNumFeatures, probs + i * kNumClasses);\n"
+        << "}\n\n"
+        << "}  // extern \"C\"\n";
+    return out.str();
+}
+
+std::string generateModelSource(const BayesTree& tree, const CodegenParams& params) {
+    return generateModelSource(toSampledTreeStore(tree), tree.getNumFeatures(), params);
+}
+
+SampledTreeStore toSampledTreeStore(const BayesTree& tree) {
+    if (!tree.isFitted())
+        throw std::logic_error("BayesTree has not been fitted");
+
+    const auto& nodes = tree.getNodes();
+    const int K = tree.getNumClasses();
+    std::vector<int> feature, left, right;
+    std::vector<double> threshold, leaf_probs;
+    std::vector<std::uint8_t> missing_left;
+    for (const Node& node : nodes) {
+        if (node.categorical)
+            throw std::invalid_argument("Flat stores do not support categorical splits; "
+                                        "trees fitted with categorical_features cannot be exported");
+        feature.push_back(node.feature);
+        missing_left.push_back(node.missing_left);
+        threshold.push_back(node.threshold);
+        right.push_back(node.right);
+        if (!node.isLeaf()) {
+            left.push_back(node.left);
+            continue;
+        }
+
+        left.push_back(static_cast<int>(leaf_probs.size() / K));
+        double total = 0.0;
+        for (double a : node.posterior_alphas) total += a;
+        for (double a : node.posterior_alphas) leaf_probs.push_back(a / total);
+    }
+
+    SampledTreeStore store;
+    store.clear(K);
+    store.addTree(feature, threshold, left, right, leaf_probs, missing_left);
+    return store;
+}
+
+void compileSharedObject(const std::string& source_path, const std::string& output_path,
+                         const std::string& compiler) {
+    // No contraction, so products and sums round exactly as in the interpreter
+    const std::string command = "\"" + compiler + "\" -std=c++17 -O2 -fPIC -shared -ffp-contract=off -o \""
+                              + output_path + "\" \"" + source_path + "\"";
+    if (std::system(command.c_str()) != 0)
+        throw std::runtime_error("Failed to compile generated model: " + command);
+}
+
+// ======== CompiledModel ========
+
+namespace {
+
+void* openLibrary(const std::string& path) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(LoadLibraryA(path.c_str()));
+#else
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+void* findSymbol(void* handle, const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#else
+    return dlsym(handle, name);
+#endif
+}
+
+void closeLibrary(void* handle) {
+#ifdef _WIN32
+    FreeLibrary(static_cast<HMODULE>(handle));
+#else
+    dlclose(handle);
+#endif
+}
+
+}  // namespace
+
+CompiledModel::CompiledModel(const std::string& shared_object_path) {
+    handle_ = openLibrary(shared_object_path);
+    if (!handle_)
+        throw std::runtime_error("Cannot load compiled model " + shared_object_path);
+
+    using IntFn = int (*)();
+    const auto abi_version = reinterpret_cast<IntFn>(findSymbol(handle_, "bayes_tree_abi_version"));
+    const auto num_classes = reinterpret_cast<IntFn>(findSymbol(handle_, "bayes_tree_num_classes"));
+    const auto num_features = reinterpret_cast<IntFn>(findSymbol(handle_, "bayes_tree_num_features"));
+    predict_ = reinterpret_cast<PredictFn>(findSymbol(handle_, "bayes_tree_predict_proba"));
+    predict_batch_ = reinterpret_cast<PredictBatchFn>(findSymbol(handle_, "bayes_tree_predict_proba_batch"));
+
+    if (!abi_version || !num_classes || !num_features || !predict_ || !predict_batch_
+        || abi_version() != kCompiledModelAbiVersion) {
+        closeLibrary(handle_);
+        throw std::runtime_error("Incompatible compiled model " + shared_object_path);
+    }
+    num_classes_ = num_classes();
+    num_features_ = num_features();
+}
+
+CompiledModel::~CompiledModel() {
+    if (handle_) closeLibrary(handle_);
+}
+
+CompiledModel::CompiledModel(CompiledModel&& other) noexcept
+    : handle_(other.handle_), num_classes_(other.num_classes_), num_features_(other.num_features_)
+    , predict_(other.predict_), predict_batch_(other.predict_batch_)
+{
+    other.handle_ = nullptr;
+}
+
+CompiledModel& CompiledModel::operator=(CompiledModel&& other) noexcept {
+    if (this != &other) {
+        if (handle_) closeLibrary(handle_);
+        handle_ = other.handle_;
+        num_classes_ = other.num_classes_;
+        num_features_ = other.num_features_;
+        predict_ = other.predict_;
+        predict_batch_ = other.predict_batch_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+int CompiledModel::getNumClasses() const {
+    return num_classes_;
+}
+
+int CompiledModel::getNumFeatures() const {
+    return num_features_;
+}
+
+std::vector<double> CompiledModel::predictProba(const std::vector<double>& x) const {
+    if (static_cast<int>(x.size()) != num_features_)
+        throw std::invalid_argument("Input dimension mismatch");
+    std::vector<double> probs(num_classes_);
+    predict_(x.data(), probs.data());
+    return probs;
+}
+
+void CompiledModel::predictProba(const double* x, double* probs) const {
+    predict_(x, probs);
+}
+
+void CompiledModel::predictProbaBatch(const double* X, std::size_t num_rows, double* probs) const {
+    predict_batch_(X, num_rows, probs);
+}
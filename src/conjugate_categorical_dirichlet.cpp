@@ -1,7 +1,10 @@
 #include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/lgamma_table.hpp"
 #include <stdexcept>
 #include <cmath>
 #include <numeric>
+#include <cassert>
 
 // Default constructor - Jeffreys prior with 2 categories
 ConjugateCategoricalDirichlet::ConjugateCategoricalDirichlet() {
@@ -47,6 +50,8 @@ ConjugateCategoricalDirichlet& ConjugateCategoricalDirichlet::operator=(const Co
 
 // Initialise with Jeffreys prior (0.5 alpha for each category)
 void ConjugateCategoricalDirichlet::initialise(int num_categories) {
+    BAYES_TREE_COUNT(ConjugateInitialisations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "initialise", this);
     prior_type_ = PriorType::Jeffreys;
     single_alpha_ = 0.5;
     
@@ -68,6 +73,8 @@ void ConjugateCategoricalDirichlet::initialise(int num_categories, double alpha)
 
 // Initialise with manual alphas
 void ConjugateCategoricalDirichlet::initialise(const std::vector<double>& alphas) {
+    BAYES_TREE_COUNT(ConjugateInitialisations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "initialise", this);
     parameter_distribution_ = std::make_unique<DirichletDistribution>(alphas);
     
     auto means = parameter_distribution_->mean();
@@ -81,6 +88,9 @@ void ConjugateCategoricalDirichlet::initialise(const std::vector<double>& alphas
 void ConjugateCategoricalDirichlet::initialiseJeffreysFromObservationDistribution(
     const CategoricalDistribution& obs_dist) {
     
+    BAYES_TREE_COUNT(ConjugateInitialisations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "initialise", this);
+    
     prior_type_ = PriorType::ManualProbs;
     single_alpha_ = -1.0;
     
@@ -131,8 +141,11 @@ void ConjugateCategoricalDirichlet::updateFromObservations(const std::vector<int
             "Length of observed value vector doesn't match distribution dimension");
     }
     
+    BAYES_TREE_COUNT(PosteriorUpdates);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "update", this);
+    
     // Get current alphas and add counts
-    auto current_alphas = parameter_distribution_->getAlpha();
+    const auto& current_alphas = parameter_distribution_->getAlpha();
     std::vector<double> new_alphas(num_categories);
     
     for (int i = 0; i < num_categories; ++i) {
@@ -146,6 +159,24 @@ void ConjugateCategoricalDirichlet::updateFromObservations(const std::vector<int
     updateObservationDistribution();
 }
 
+void ConjugateCategoricalDirichlet::updateFromObservationsUnchecked(const std::vector<int>& counts) {
+    int num_categories = parameter_distribution_->dimension();
+    assert(num_categories == static_cast<int>(counts.size()) &&
+           "Length of observed value vector doesn't match distribution dimension");
+    BAYES_TREE_COUNT(PosteriorUpdates);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "update", this);
+    
+    const auto& current_alphas = parameter_distribution_->getAlpha();
+    std::vector<double> new_alphas(num_categories);
+    
+    for (int i = 0; i < num_categories; ++i) {
+        new_alphas[i] = current_alphas[i] + counts[i];
+    }
+    
+    parameter_distribution_->setAlphaUnchecked(new_alphas);
+    observation_distribution_->set_probs_unchecked(parameter_distribution_->mean());
+}
+
 // Calculate marginalised log likelihood from observed counts
 double ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations(
     const std::vector<int>& counts) const {
@@ -157,13 +188,32 @@ double ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations(
             "Length of observed value vector doesn't match distribution dimension");
     }
     
-    auto alphas = parameter_distribution_->getAlpha();
+    return getLogLikelihoodFromObservationsUnchecked(counts);
+}
+
+double ConjugateCategoricalDirichlet::getLogLikelihoodFromObservationsUnchecked(
+    const std::vector<int>& counts) const {
+    
+    const auto& alphas = parameter_distribution_->getAlpha();
+    const int num_categories = static_cast<int>(alphas.size());
+    assert(num_categories == static_cast<int>(counts.size()) &&
+           "Length of observed value vector doesn't match distribution dimension");
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "log_likelihood", this);
+    
+    // Jeffreys and integer / half-integer alphas: every lgamma argument is a
+    // half-integer, so use the precomputed table instead of libm. The flag is
+    // cached by the parameter distribution whenever its alphas change.
+    if (parameter_distribution_->hasHalfIntegerAlphas()) {
+        return latticeLogLikelihood(alphas, counts);
+    }
     
     double alpha_total = 0.0;
     double count_total = 0.0;
     double log_likelihood = 0.0;
     
     for (int i = 0; i < num_categories; ++i) {
+        assert(counts[i] >= 0 && "Observed counts must be non-negative");
         count_total += counts[i];
         alpha_total += alphas[i];
         
@@ -175,6 +225,150 @@ double ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations(
     return log_likelihood;
 }
 
+// Sparse update: only observed categories change
+void ConjugateCategoricalDirichlet::updateFromObservations(const SparseCounts& counts) {
+    validateSparseCounts(counts, getNumCategories());
+    BAYES_TREE_COUNT(PosteriorUpdates);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "update", this);
+    
+    std::vector<double> new_alphas = parameter_distribution_->getAlpha();
+    for (const auto& c : counts) {
+        new_alphas[c.index] += c.count;
+    }
+    
+    parameter_distribution_->setAlphaUnchecked(new_alphas);
+    updateObservationDistribution();
+}
+
+// Sparse marginal likelihood: unobserved categories contribute nothing and
+// the alpha total is cached by the parameter distribution
+double ConjugateCategoricalDirichlet::getLogLikelihoodFromObservations(
+    const SparseCounts& counts) const {
+    
+    validateSparseCounts(counts, getNumCategories());
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "log_likelihood", this);
+    
+    const auto& alphas = parameter_distribution_->getAlpha();
+    const double alpha_total = parameter_distribution_->getAlphaTotal();
+    
+    double count_total = 0.0;
+    double log_likelihood = 0.0;
+    
+    // Only the touched alphas and the total enter the formula, so the table
+    // path applies whenever those lie on the half-integer lattice
+    const long twice_alpha_total = HalfIntegerLgammaTable::twiceIfLattice(alpha_total);
+    bool lattice = twice_alpha_total > 0;
+    for (const auto& c : counts) {
+        if (!lattice) break;
+        lattice = HalfIntegerLgammaTable::twiceIfLattice(alphas[c.index]) > 0;
+    }
+    if (lattice) {
+        const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+        long twice_count_total = 0;
+        for (const auto& c : counts) {
+            const long twice_alpha = static_cast<long>(2.0 * alphas[c.index]);
+            twice_count_total += 2L * c.count;
+            log_likelihood += lgamma_half(twice_alpha + 2L * c.count) - lgamma_half(twice_alpha);
+        }
+        return log_likelihood + lgamma_half(twice_alpha_total)
+                              - lgamma_half(twice_alpha_total + twice_count_total);
+    }
+    
+    for (const auto& c : counts) {
+        count_total += c.count;
+        log_likelihood += std::lgamma(c.count + alphas[c.index]) - std::lgamma(alphas[c.index]);
+    }
+    
+    log_likelihood += std::lgamma(alpha_total) - std::lgamma(count_total + alpha_total);
+    
+    return log_likelihood;
+}
+
+namespace {
+
+void validateWeightedCounts(const std::vector<double>& counts, int num_categories) {
+    if (num_categories != static_cast<int>(counts.size())) {
+        throw std::invalid_argument(
+            "Length of observed value vector doesn't match distribution dimension");
+    }
+    for (double c : counts) {
+        if (!std::isfinite(c) || c < 0.0) {
+            throw std::invalid_argument("Weighted counts must be finite and non-negative");
+        }
+    }
+}
+
+}  // namespace
+
+// Update from real-valued (weighted) counts
+void ConjugateCategoricalDirichlet::updateFromWeightedObservations(const std::vector<double>& counts) {
+    validateWeightedCounts(counts, parameter_distribution_->dimension());
+    BAYES_TREE_COUNT(PosteriorUpdates);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "update", this);
+    
+    std::vector<double> new_alphas = parameter_distribution_->getAlpha();
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        new_alphas[i] += counts[i];
+    }
+    
+    parameter_distribution_->setAlphaUnchecked(new_alphas);
+    updateObservationDistribution();
+}
+
+// Marginal likelihood of real-valued counts: the Dirichlet-multinomial
+// formula with lgamma of real arguments (the multinomial coefficient is
+// omitted, as for integer counts)
+double ConjugateCategoricalDirichlet::getLogLikelihoodFromWeightedObservations(
+    const std::vector<double>& counts) const {
+    
+    validateWeightedCounts(counts, parameter_distribution_->dimension());
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    BAYES_TREE_TRACE("ConjugateCategoricalDirichlet", "log_likelihood", this);
+    
+    const auto& alphas = parameter_distribution_->getAlpha();
+    const double alpha_total = parameter_distribution_->getAlphaTotal();
+    
+    double count_total = 0.0;
+    double log_likelihood = 0.0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0.0) continue;
+        count_total += counts[i];
+        log_likelihood += std::lgamma(counts[i] + alphas[i]) - std::lgamma(alphas[i]);
+    }
+    
+    return log_likelihood + std::lgamma(alpha_total) - std::lgamma(count_total + alpha_total);
+}
+
+// Table-driven marginal likelihood; all alphas must be (half-)integers
+double ConjugateCategoricalDirichlet::latticeLogLikelihood(
+    const std::vector<double>& alphas, const std::vector<int>& counts) {
+    
+    const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+    const int num_categories = static_cast<int>(alphas.size());
+    
+    long twice_alpha_total = 0;
+    long twice_count_total = 0;
+    double log_likelihood = 0.0;
+    
+    for (int i = 0; i < num_categories; ++i) {
+        assert(counts[i] >= 0 && "Observed counts must be non-negative");
+        const long twice_alpha = static_cast<long>(2.0 * alphas[i]);
+        const long twice_count = 2L * counts[i];
+        twice_alpha_total += twice_alpha;
+        twice_count_total += twice_count;
+        
+        if (counts[i] != 0) {
+            log_likelihood += lgamma_half(twice_count + twice_alpha) - lgamma_half(twice_alpha);
+        }
+    }
+    
+    log_likelihood += lgamma_half(twice_alpha_total)
+                    - lgamma_half(twice_count_total + twice_alpha_total);
+    
+    return log_likelihood;
+}
+
 // Accessors
 const CategoricalDistribution& ConjugateCategoricalDirichlet::getObservationDistribution() const {
     return *observation_distribution_;
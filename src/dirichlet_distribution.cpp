@@ -1,14 +1,20 @@
 // DirichletDistribution.cpp
 #include "bayes_tree/dirichlet_distribution.hpp"
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/lgamma_table.hpp"
+#include <algorithm>
 #include <numeric>
 #include <stdexcept>
 #include <cmath>
 #include <limits>
+#include <cassert>
 
 DirichletDistribution::DirichletDistribution(
     const std::vector<double>& concentration_params, 
     unsigned int seed)
-    : alpha(concentration_params), gen(seed) {
+    : alpha(concentration_params), alpha_total(0.0), half_integer_alphas(false), gen(seed) {
+    BAYES_TREE_COUNT(DirichletConstructions);
+    BAYES_TREE_TRACE("DirichletDistribution", "construct", this);
     if (alpha.empty()) {
         throw std::invalid_argument("Concentration parameters cannot be empty");
     }
@@ -17,6 +23,7 @@ DirichletDistribution::DirichletDistribution(
             throw std::invalid_argument("All concentration parameters must be positive");
         }
     }
+    updateCachedSums();
 }
 
 std::vector<double> DirichletDistribution::sample() const {
@@ -48,7 +55,7 @@ std::vector<std::vector<double>> DirichletDistribution::sample(size_t n) const {
 }
 
 std::vector<double> DirichletDistribution::mean() const {
-    double alpha_sum = std::accumulate(alpha.begin(), alpha.end(), 0.0);
+    double alpha_sum = alpha_total;
     std::vector<double> m(alpha.size());
     for (size_t i = 0; i < alpha.size(); ++i) {
         m[i] = alpha[i] / alpha_sum;
@@ -57,7 +64,7 @@ std::vector<double> DirichletDistribution::mean() const {
 }
 
 std::vector<double> DirichletDistribution::variance() const {
-    double alpha_sum = std::accumulate(alpha.begin(), alpha.end(), 0.0);
+    double alpha_sum = alpha_total;
     std::vector<double> var(alpha.size());
     for (size_t i = 0; i < alpha.size(); ++i) {
         var[i] = (alpha[i] * (alpha_sum - alpha[i])) / 
@@ -70,6 +77,21 @@ const std::vector<double>& DirichletDistribution::getAlpha() const {
     return alpha;
 }
 
+double DirichletDistribution::getAlphaTotal() const {
+    return alpha_total;
+}
+
+bool DirichletDistribution::hasHalfIntegerAlphas() const {
+    return half_integer_alphas;
+}
+
+void DirichletDistribution::updateCachedSums() {
+    alpha_total = std::accumulate(alpha.begin(), alpha.end(), 0.0);
+    half_integer_alphas = std::all_of(alpha.begin(), alpha.end(), [](double a) {
+        return HalfIntegerLgammaTable::twiceIfLattice(a) > 0;
+    });
+}
+
 void DirichletDistribution::setAlpha(const std::vector<double>& new_alpha) {
     if (new_alpha.size() != alpha.size()) {
         throw std::invalid_argument("New alpha must have same size as original");
@@ -80,6 +102,18 @@ void DirichletDistribution::setAlpha(const std::vector<double>& new_alpha) {
         }
     }
     alpha = new_alpha;
+    updateCachedSums();
+}
+
+void DirichletDistribution::setAlphaUnchecked(const std::vector<double>& new_alpha) {
+    assert(new_alpha.size() == alpha.size() && "New alpha must have same size as original");
+#ifndef NDEBUG
+    for (double a : new_alpha) {
+        assert(a > 0.0 && "All concentration parameters must be positive");
+    }
+#endif
+    alpha = new_alpha;
+    updateCachedSums();
 }
 
 size_t DirichletDistribution::dimension() const {
@@ -0,0 +1,52 @@
+#include "bayes_tree/instrumentation.hpp"
+
+void Instrumentation::enableCounters(bool enabled) {
+    counters_enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool Instrumentation::countersEnabled() {
+    return counters_enabled_.load(std::memory_order_relaxed);
+}
+
+InstrumentationCounters Instrumentation::counters() {
+    auto get = [](Counter c) {
+        return counters_[static_cast<std::size_t>(c)].load(std::memory_order_relaxed);
+    };
+
+    InstrumentationCounters snapshot;
+    snapshot.categorical_constructions = get(Counter::CategoricalConstructions);
+    snapshot.dirichlet_constructions = get(Counter::DirichletConstructions);
+    snapshot.conjugate_initialisations = get(Counter::ConjugateInitialisations);
+    snapshot.tree_constructions = get(Counter::TreeConstructions);
+    snapshot.posterior_updates = get(Counter::PosteriorUpdates);
+    snapshot.likelihood_evaluations = get(Counter::LikelihoodEvaluations);
+    return snapshot;
+}
+
+void Instrumentation::resetCounters() {
+    for (auto& c : counters_) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Instrumentation::setTraceHook(TraceHook hook) {
+    trace_hook_.store(hook, std::memory_order_release);
+}
+
+Instrumentation::TraceHook Instrumentation::traceHook() {
+    return trace_hook_.load(std::memory_order_acquire);
+}
+
+void Instrumentation::trace(const char* component, const char* event, const void* object) {
+    if (TraceHook hook = trace_hook_.load(std::memory_order_acquire)) {
+        hook(TraceEvent{component, event, object});
+    }
+}
+
+bool Instrumentation::traceCompiledIn() {
+#ifdef BAYES_TREE_ENABLE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
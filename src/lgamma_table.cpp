@@ -0,0 +1,14 @@
+#include "bayes_tree/lgamma_table.hpp"
+#include <limits>
+
+HalfIntegerLgammaTable::HalfIntegerLgammaTable(std::size_t size) : table_(size) {
+    if (!table_.empty())
+        table_[0] = std::numeric_limits<double>::infinity();  // lgamma(0)
+    for (std::size_t j = 1; j < table_.size(); ++j)
+        table_[j] = std::lgamma(0.5 * static_cast<double>(j));
+}
+
+const HalfIntegerLgammaTable& HalfIntegerLgammaTable::instance() {
+    static const HalfIntegerLgammaTable table(BAYES_TREE_LGAMMA_TABLE_SIZE);
+    return table;
+}
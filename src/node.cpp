@@ -1,2 +1,6 @@
 #include "bayes_tree/node.hpp"
 Node::Node() = default;
+
+bool Node::isLeaf() const {
+    return left < 0;
+}
@@ -0,0 +1,506 @@
+#include "bayes_tree/prediction_server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kPollMs = 50;                        // Stop-flag check interval of blocking waits
+constexpr std::uint32_t kMaxFeatures = 1u << 20;   // Larger requests close the connection
+constexpr std::size_t kReadChunk = 1 << 16;        // Bytes taken from a socket per recv
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Blocking read of exactly n bytes
+bool readAll(int fd, void* buffer, std::size_t n) {
+    auto* out = static_cast<char*>(buffer);
+    while (n > 0) {
+        const ssize_t got = ::recv(fd, out, n, 0);
+        if (got == 0) return false;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        out += got;
+        n -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* buffer, std::size_t n) {
+    const auto* in = static_cast<const char*>(buffer);
+    while (n > 0) {
+        const ssize_t sent = ::send(fd, in, n, kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        in += sent;
+        n -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+bool setNonBlocking(int fd) {
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Invalid socket path: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+}  // namespace
+
+// A client connection. Its I/O thread and queued requests share ownership,
+// so the descriptors stay open until the last response has been queued.
+// The batcher only appends to the outbox and wakes the I/O thread through a
+// self-pipe; all socket I/O happens on the I/O thread, without blocking.
+struct PredictionServer::Connection {
+    Connection(int fd, int wake_read, int wake_write) : fd(fd), wake_read(wake_read), wake_write(wake_write) {}
+    ~Connection() {
+        ::close(fd);
+        ::close(wake_read);
+        ::close(wake_write);
+    }
+
+    // Queue one response; probs is read only if num_classes > 0. If the
+    // client has left more than max_bytes unread, drop it and mark the
+    // connection for closing instead.
+    void respond(const PredictionResponseHeader& header, const double* probs, std::size_t max_bytes) {
+        const std::size_t probs_bytes = header.num_classes * sizeof(double);
+        const std::size_t n = sizeof(header) + probs_bytes;
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --in_flight;
+            const std::size_t pending = outbox.size() - outbox_begin;
+            if (!overflowed && pending + n > max_bytes) {
+                overflowed = true;
+                outbox.clear();
+                outbox_begin = 0;
+                wake = true;
+            }
+            if (!overflowed) {
+                const std::size_t end = outbox.size();
+                outbox.resize(end + n);
+                std::memcpy(outbox.data() + end, &header, sizeof(header));
+                if (probs_bytes > 0)
+                    std::memcpy(outbox.data() + end + sizeof(header), probs, probs_bytes);
+                wake = pending == 0;
+            }
+            wake = wake || in_flight == 0;
+        }
+        if (wake) {
+            const char byte = 0;
+            [[maybe_unused]] const ssize_t ignored = ::write(wake_write, &byte, 1);  // Full pipe: already woken
+        }
+    }
+
+    // Send as much of the outbox as the socket accepts. False on error.
+    bool flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (outbox_begin < outbox.size()) {
+            const ssize_t sent = ::send(fd, outbox.data() + outbox_begin, outbox.size() - outbox_begin, kSendFlags);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                break;
+            }
+            outbox_begin += static_cast<std::size_t>(sent);
+        }
+        if (outbox_begin == outbox.size()) {
+            outbox.clear();
+            outbox_begin = 0;
+        } else if (outbox_begin > outbox.size() / 2) {
+            outbox.erase(outbox.begin(), outbox.begin() + static_cast<std::ptrdiff_t>(outbox_begin));
+            outbox_begin = 0;
+        }
+        return true;
+    }
+
+    const int fd;         // Non-blocking client socket
+    const int wake_read;  // Self-pipe, non-blocking at both ends
+    const int wake_write;
+
+    std::mutex mutex;
+    std::vector<char> outbox;      // Unsent response bytes from outbox_begin on
+    std::size_t outbox_begin = 0;
+    int in_flight = 0;             // Requests queued for scoring, not yet answered
+    bool overflowed = false;       // Outbox exceeded max_outbound_bytes; closing
+};
+
+// ======== PredictionServer ========
+
+PredictionServer::PredictionServer(const std::string& model_path, const PredictionServerParams& params)
+    : params_(params)
+{
+    if (params_.max_batch_size < 1)
+        throw std::invalid_argument("max_batch_size must be positive");
+    if (params_.max_wait_us < 0)
+        throw std::invalid_argument("max_wait_us must be non-negative");
+    if (params_.max_outbound_bytes == 0)
+        throw std::invalid_argument("max_outbound_bytes must be positive");
+    socketAddress(params_.socket_path);  // Validate early
+    reloadModel(model_path);
+    reloads_ = 0;
+}
+
+PredictionServer::~PredictionServer() {
+    stop();
+}
+
+void PredictionServer::start() {
+    if (running_) return;
+
+    // Replace a stale socket from an earlier run, but never a regular file
+    struct stat info {};
+    if (::stat(params_.socket_path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        ::unlink(params_.socket_path.c_str());
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+        throw std::runtime_error("Cannot create socket");
+    const sockaddr_un address = socketAddress(params_.socket_path);
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listen_fd_, 128) != 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Cannot listen on " + params_.socket_path + ": " + std::strerror(errno));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = false;
+    }
+    running_ = true;
+    batcher_ = std::thread(&PredictionServer::batchLoop, this);
+    acceptor_ = std::thread(&PredictionServer::acceptLoop, this);
+}
+
+// Connection threads stop reading within one poll interval. The batcher
+// keeps going until the queue is empty, so every queued request is answered;
+// connection threads then send what their clients are still draining.
+void PredictionServer::stop() {
+    if (!running_.exchange(false)) return;
+
+    acceptor_.join();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    batcher_.join();
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (auto& connection : connections_) connection.thread.join();
+        connections_.clear();
+    }
+
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(params_.socket_path.c_str());
+}
+
+void PredictionServer::reloadModel(const std::string& model_path) {
+    std::ifstream in(model_path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open model " + model_path);
+
+    auto model = std::make_shared<Model>();
+    model->store = SampledTreeStore::load(in);
+    if (model->store.totalWeight() == 0)
+        throw std::runtime_error("Model " + model_path + " holds no trees");
+    model->num_features_used = model->store.getNumFeaturesUsed();
+
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    model->version = next_version_++;
+    model_ = std::move(model);
+    ++reloads_;
+}
+
+std::uint32_t PredictionServer::getModelVersion() const {
+    return currentModel()->version;
+}
+
+PredictionServerStats PredictionServer::getStats() const {
+    PredictionServerStats stats;
+    stats.requests = requests_;
+    stats.rejected = rejected_;
+    stats.batches = batches_;
+    stats.reloads = reloads_;
+    stats.slow_clients_closed = slow_clients_closed_;
+    return stats;
+}
+
+std::shared_ptr<const PredictionServer::Model> PredictionServer::currentModel() const {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    return model_;
+}
+
+void PredictionServer::acceptLoop() {
+    while (running_) {
+        pollfd p{listen_fd_, POLLIN, 0};
+        if (::poll(&p, 1, kPollMs) <= 0) continue;
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+        int wake[2];
+        if (::pipe(wake) != 0) {
+            ::close(fd);
+            continue;
+        }
+        auto connection = std::make_shared<Connection>(fd, wake[0], wake[1]);
+        if (!setNonBlocking(fd) || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1])) continue;
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        // Reap threads of closed connections
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if (it->done->load()) {
+                it->thread.join();
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::thread thread([this, connection, done] {
+            connectionLoop(connection);
+            *done = true;
+        });
+        connections_.push_back({std::move(thread), std::move(done)});
+    }
+}
+
+// Parse requests as their bytes arrive and flush queued responses whenever
+// the socket accepts them. Reading ends at EOF or stop(); the thread then
+// stays until every queued request is answered and sent. It closes the
+// connection early on errors, oversized requests, an overflowing outbox, or
+// a client that stops draining its responses while the server stops.
+void PredictionServer::connectionLoop(const std::shared_ptr<Connection>& connection) {
+    constexpr std::size_t kHeaderBytes = sizeof(PredictionRequestHeader);
+    std::vector<char> inbox;
+    std::size_t inbox_begin = 0;
+    bool reading = true;
+
+    // Queue every complete request in the inbox; false on a malformed one
+    const auto parseRequests = [&] {
+        while (inbox.size() - inbox_begin >= kHeaderBytes) {
+            PredictionRequestHeader header;
+            std::memcpy(&header, inbox.data() + inbox_begin, kHeaderBytes);
+            if (header.num_features > kMaxFeatures) return false;
+            const std::size_t x_bytes = header.num_features * sizeof(double);
+            if (inbox.size() - inbox_begin < kHeaderBytes + x_bytes) break;
+
+            Pending pending{connection, header.id, std::vector<double>(header.num_features),
+                            std::chrono::steady_clock::now()};
+            std::memcpy(pending.x.data(), inbox.data() + inbox_begin + kHeaderBytes, x_bytes);
+            inbox_begin += kHeaderBytes + x_bytes;
+            if (!enqueue(std::move(pending))) {
+                reading = false;  // Server is stopping
+                break;
+            }
+        }
+        inbox.erase(inbox.begin(), inbox.begin() + static_cast<std::ptrdiff_t>(inbox_begin));
+        inbox_begin = 0;
+        return true;
+    };
+
+    while (true) {
+        if (!running_) reading = false;
+        bool want_write = false;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->overflowed) {
+                ++slow_clients_closed_;
+                break;
+            }
+            want_write = connection->outbox_begin < connection->outbox.size();
+            if (!reading && !want_write && connection->in_flight == 0) break;
+        }
+
+        pollfd fds[2] = {
+            {connection->fd, static_cast<short>((reading ? POLLIN : 0) | (want_write ? POLLOUT : 0)), 0},
+            {connection->wake_read, POLLIN, 0},
+        };
+        const int ready = ::poll(fds, 2, kPollMs);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) {
+            // A client that drains nothing for a whole interval cannot hold up stop()
+            if (ready == 0 && want_write && !running_) break;
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (::read(connection->wake_read, drain, sizeof(drain)) > 0) {}
+        }
+        if ((fds[0].revents & POLLOUT) && !connection->flush()) break;
+        if (!reading && (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))) break;
+
+        if (reading && (fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+            bool error = false;
+            while (true) {
+                const std::size_t size = inbox.size();
+                inbox.resize(size + kReadChunk);
+                const ssize_t got = ::recv(connection->fd, inbox.data() + size, kReadChunk, 0);
+                inbox.resize(size + static_cast<std::size_t>(std::max<ssize_t>(got, 0)));
+                if (got > 0) continue;
+                if (got == 0) reading = false;  // Client is done sending
+                else if (errno == EINTR) continue;
+                else error = errno != EAGAIN && errno != EWOULDBLOCK;
+                break;
+            }
+            if (error || !parseRequests()) break;
+        }
+    }
+    ::shutdown(connection->fd, SHUT_RDWR);
+}
+
+// Queue a request unless the server is stopping
+bool PredictionServer::enqueue(Pending&& pending) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (stopping_) return false;
+        {
+            std::lock_guard<std::mutex> connection_lock(pending.connection->mutex);
+            ++pending.connection->in_flight;
+        }
+        queue_.push_back(std::move(pending));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+// Take a batch once it is full or its oldest request has waited
+// max_wait_us, then score it outside the queue lock
+void PredictionServer::batchLoop() {
+    const auto max_wait = std::chrono::microseconds(params_.max_wait_us);
+    const auto max_batch = static_cast<std::size_t>(params_.max_batch_size);
+    std::vector<Pending> batch;
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    while (true) {
+        queue_cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) break;  // Stopping with nothing left
+
+        const auto deadline = queue_.front().arrival + max_wait;
+        queue_cv_.wait_until(lock, deadline, [&] { return stopping_ || queue_.size() >= max_batch; });
+
+        const std::size_t n = std::min(max_batch, queue_.size());
+        batch.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+
+        lock.unlock();
+        scoreBatch(batch);
+        lock.lock();
+    }
+}
+
+void PredictionServer::scoreBatch(std::vector<Pending>& batch) {
+    const std::shared_ptr<const Model> model = currentModel();
+    const int K = model->store.getNumClasses();
+    const std::size_t stride = static_cast<std::size_t>(model->num_features_used);
+
+    // Pack accepted rows, truncated to the features the model reads
+    std::vector<std::size_t> accepted;
+    std::vector<double> X;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].x.size() < stride) {
+            batch[i].connection->respond({batch[i].id, 0, model->version}, nullptr, params_.max_outbound_bytes);
+            ++rejected_;
+            continue;
+        }
+        accepted.push_back(i);
+        X.insert(X.end(), batch[i].x.begin(), batch[i].x.begin() + stride);
+    }
+
+    // A scoring failure rejects the batch instead of ending the batcher thread
+    std::vector<double> probs(accepted.size() * K);
+    std::uint32_t num_classes = static_cast<std::uint32_t>(K);
+    try {
+        if (!accepted.empty())
+            model->store.predictProbaBatch(X.data(), accepted.size(), stride, probs.data());
+    } catch (const std::exception&) {
+        num_classes = 0;
+        rejected_ += accepted.size();
+    }
+
+    for (std::size_t j = 0; j < accepted.size(); ++j) {
+        const Pending& pending = batch[accepted[j]];
+        pending.connection->respond({pending.id, num_classes, model->version},
+                                    probs.data() + j * K, params_.max_outbound_bytes);
+    }
+
+    requests_ += batch.size();
+    ++batches_;
+    batch.clear();  // Drop connection references before the next wait
+}
+
+// ======== PredictionClient ========
+
+PredictionClient::PredictionClient(const std::string& socket_path) {
+    const sockaddr_un address = socketAddress(socket_path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (fd_ >= 0) ::close(fd_);
+        throw std::runtime_error("Cannot connect to " + socket_path + ": " + reason);
+    }
+}
+
+PredictionClient::~PredictionClient() {
+    ::close(fd_);
+}
+
+void PredictionClient::send(std::uint32_t id, const std::vector<double>& x) {
+    const PredictionRequestHeader header{id, static_cast<std::uint32_t>(x.size())};
+    if (!writeAll(fd_, &header, sizeof(header)) || !writeAll(fd_, x.data(), x.size() * sizeof(double)))
+        throw std::runtime_error("Prediction server connection lost");
+}
+
+PredictionClient::Response PredictionClient::receive() {
+    PredictionResponseHeader header;
+    if (!readAll(fd_, &header, sizeof(header)))
+        throw std::runtime_error("Prediction server connection lost");
+
+    Response response;
+    response.id = header.id;
+    response.model_version = header.model_version;
+    response.probs.resize(header.num_classes);
+    if (!readAll(fd_, response.probs.data(), response.probs.size() * sizeof(double)))
+        throw std::runtime_error("Prediction server connection lost");
+    return response;
+}
+
+std::vector<double> PredictionClient::predictProba(const std::vector<double>& x) {
+    const std::uint32_t id = next_id_++;
+    send(id, x);
+    Response response = receive();
+    if (response.id != id)
+        throw std::logic_error("predictProba cannot be mixed with pipelined requests");
+    if (response.probs.empty())
+        throw std::runtime_error("Prediction server rejected the request");
+    return std::move(response.probs);
+}
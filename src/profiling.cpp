@@ -0,0 +1,80 @@
+#include "bayes_tree/profiling.hpp"
+#include <chrono>
+#include <ctime>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+const char* trainingPhaseName(TrainingPhase phase) {
+    switch (phase) {
+        case TrainingPhase::Binning:      return "binning";
+        case TrainingPhase::Histogram:    return "histogram";
+        case TrainingPhase::SplitScoring: return "split_scoring";
+        case TrainingPhase::Partition:    return "partition";
+        default:                          return "unknown";
+    }
+}
+
+void TrainingReport::aggregateThreads() {
+    phases = {};
+    candidate_splits_scored = 0;
+    candidate_splits_pruned = 0;
+    features_pruned = 0;
+    split_bounds_evaluated = 0;
+    likelihood_evaluations = 0;
+    bytes_touched = 0;
+
+    for (const auto& t : threads) {
+        for (std::size_t p = 0; p < kNumTrainingPhases; ++p) {
+            phases[p].wall_seconds += t.phases[p].wall_seconds;
+            phases[p].cpu_seconds += t.phases[p].cpu_seconds;
+        }
+        candidate_splits_scored += t.candidate_splits_scored;
+        candidate_splits_pruned += t.candidate_splits_pruned;
+        features_pruned += t.features_pruned;
+        split_bounds_evaluated += t.split_bounds_evaluated;
+        likelihood_evaluations += t.likelihood_evaluations;
+        bytes_touched += t.bytes_touched;
+    }
+}
+
+double wallSeconds() {
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+double threadCpuSeconds() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    auto to_seconds = [](const FILETIME& ft) {
+        ULARGE_INTEGER v;
+        v.LowPart = ft.dwLowDateTime;
+        v.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(v.QuadPart) * 1e-7;  // 100ns ticks
+    };
+    return to_seconds(kernel) + to_seconds(user);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+ScopedPhaseTimer::ScopedPhaseTimer(ThreadReport& report, TrainingPhase phase)
+    : timing_(report.phases[static_cast<std::size_t>(phase)])
+    , wall_start_(wallSeconds())
+    , cpu_start_(threadCpuSeconds())
+{
+}
+
+ScopedPhaseTimer::~ScopedPhaseTimer() {
+    timing_.wall_seconds += wallSeconds() - wall_start_;
+    timing_.cpu_seconds += threadCpuSeconds() - cpu_start_;
+}
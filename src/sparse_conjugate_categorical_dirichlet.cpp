@@ -0,0 +1,133 @@
+#include "bayes_tree/sparse_conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/lgamma_table.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Constructor with number of categories (Jeffreys prior)
+SparseConjugateCategoricalDirichlet::SparseConjugateCategoricalDirichlet(int num_categories)
+    : SparseConjugateCategoricalDirichlet(num_categories, 0.5) {}
+
+// Constructor with equal alpha for all categories
+SparseConjugateCategoricalDirichlet::SparseConjugateCategoricalDirichlet(int num_categories, double alpha)
+    : num_categories_(num_categories)
+    , prior_alpha_(alpha)
+{
+    if (num_categories <= 0)
+        throw std::invalid_argument("Number of categories must be positive");
+    if (alpha <= 0.0)
+        throw std::invalid_argument("All concentration parameters must be positive");
+
+    prior_alpha_total_ = num_categories_ * prior_alpha_;
+    lgamma_prior_alpha_ = std::lgamma(prior_alpha_);
+    twice_prior_alpha_ = HalfIntegerLgammaTable::twiceIfLattice(prior_alpha_);
+
+    BAYES_TREE_COUNT(ConjugateInitialisations);
+    BAYES_TREE_TRACE("SparseConjugateCategoricalDirichlet", "initialise", this);
+}
+
+// Merge counts into the sparse delta (both sorted by index)
+void SparseConjugateCategoricalDirichlet::updateFromObservations(const SparseCounts& counts) {
+    validateSparseCounts(counts, num_categories_);
+    BAYES_TREE_COUNT(PosteriorUpdates);
+    BAYES_TREE_TRACE("SparseConjugateCategoricalDirichlet", "update", this);
+
+    SparseCounts merged;
+    merged.reserve(delta_.size() + counts.size());
+    auto a = delta_.begin();
+    auto b = counts.begin();
+    while (a != delta_.end() || b != counts.end()) {
+        if (b == counts.end() || (a != delta_.end() && a->index < b->index)) {
+            merged.push_back(*a++);
+        } else if (a == delta_.end() || b->index < a->index) {
+            if (b->count > 0) merged.push_back(*b);
+            ++b;
+        } else {
+            merged.push_back({a->index, a->count + b->count});
+            ++a;
+            ++b;
+        }
+    }
+    for (const auto& c : counts) total_count_ += c.count;
+    delta_ = std::move(merged);
+}
+
+// Marginalised log likelihood; only observed categories contribute
+double SparseConjugateCategoricalDirichlet::getLogLikelihoodFromObservations(
+    const SparseCounts& counts) const {
+    
+    validateSparseCounts(counts, num_categories_);
+    BAYES_TREE_COUNT(LikelihoodEvaluations);
+    BAYES_TREE_TRACE("SparseConjugateCategoricalDirichlet", "log_likelihood", this);
+
+    long count_total = 0;
+    double log_likelihood = 0.0;
+    const double alpha_total = getAlphaTotal();
+
+    if (twice_prior_alpha_ > 0) {
+        // Integer posterior deltas keep every argument on the half-integer lattice
+        const auto& lgamma_half = HalfIntegerLgammaTable::instance();
+        const long twice_alpha_total = twice_prior_alpha_ * num_categories_ + 2 * total_count_;
+        for (const auto& c : counts) {
+            const long twice_alpha = twice_prior_alpha_ + 2L * observedCount(c.index);
+            log_likelihood += lgamma_half(twice_alpha + 2L * c.count) - lgamma_half(twice_alpha);
+            count_total += c.count;
+        }
+        return log_likelihood + lgamma_half(twice_alpha_total)
+                              - lgamma_half(twice_alpha_total + 2 * count_total);
+    }
+
+    for (const auto& c : counts) {
+        const int observed = observedCount(c.index);
+        const double alpha = prior_alpha_ + observed;
+        const double lgamma_alpha = observed == 0 ? lgamma_prior_alpha_ : std::lgamma(alpha);
+        log_likelihood += std::lgamma(alpha + c.count) - lgamma_alpha;
+        count_total += c.count;
+    }
+    return log_likelihood + std::lgamma(alpha_total) - std::lgamma(alpha_total + count_total);
+}
+
+// Accessors
+int SparseConjugateCategoricalDirichlet::getNumCategories() const {
+    return num_categories_;
+}
+
+int SparseConjugateCategoricalDirichlet::getNumObservedCategories() const {
+    return static_cast<int>(delta_.size());
+}
+
+double SparseConjugateCategoricalDirichlet::getPriorAlpha() const {
+    return prior_alpha_;
+}
+
+double SparseConjugateCategoricalDirichlet::getAlpha(int category) const {
+    if (category < 0 || category >= num_categories_)
+        throw std::out_of_range("Category index out of range");
+    return prior_alpha_ + observedCount(category);
+}
+
+double SparseConjugateCategoricalDirichlet::getAlphaTotal() const {
+    return prior_alpha_total_ + static_cast<double>(total_count_);
+}
+
+double SparseConjugateCategoricalDirichlet::getMean(int category) const {
+    return getAlpha(category) / getAlphaTotal();
+}
+
+const SparseCounts& SparseConjugateCategoricalDirichlet::getObservedCounts() const {
+    return delta_;
+}
+
+std::vector<double> SparseConjugateCategoricalDirichlet::getAlphas() const {
+    std::vector<double> alphas(num_categories_, prior_alpha_);
+    for (const auto& c : delta_) alphas[c.index] += c.count;
+    return alphas;
+}
+
+// Private methods
+int SparseConjugateCategoricalDirichlet::observedCount(int category) const {
+    auto it = std::lower_bound(delta_.begin(), delta_.end(), category,
+                               [](const SparseCount& c, int index) { return c.index < index; });
+    return (it != delta_.end() && it->index == category) ? it->count : 0;
+}
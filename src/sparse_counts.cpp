@@ -0,0 +1,30 @@
+#include "bayes_tree/sparse_counts.hpp"
+#include <stdexcept>
+
+void validateSparseCounts(const SparseCounts& counts, int num_categories) {
+    int previous = -1;
+    for (const auto& c : counts) {
+        if (c.index < 0 || c.index >= num_categories)
+            throw std::invalid_argument("Sparse count index out of range");
+        if (c.index <= previous)
+            throw std::invalid_argument("Sparse count indices must be strictly increasing");
+        if (c.count < 0)
+            throw std::invalid_argument("Observed counts must be non-negative");
+        previous = c.index;
+    }
+}
+
+SparseCounts toSparseCounts(const std::vector<int>& dense) {
+    SparseCounts sparse;
+    for (int i = 0; i < static_cast<int>(dense.size()); ++i) {
+        if (dense[i] != 0) sparse.push_back({i, dense[i]});
+    }
+    return sparse;
+}
+
+std::vector<int> toDenseCounts(const SparseCounts& sparse, int num_categories) {
+    validateSparseCounts(sparse, num_categories);
+    std::vector<int> dense(num_categories, 0);
+    for (const auto& c : sparse) dense[c.index] = c.count;
+    return dense;
+}
@@ -0,0 +1,909 @@
+#include "bayes_tree/tree_sampler.hpp"
+#include "bayes_tree/parallel.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+std::uint64_t splitMix64(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+constexpr std::uint64_t kGoldenGamma = 0x9e3779b97f4a7c15ULL;
+constexpr double kNegInf = -std::numeric_limits<double>::infinity();
+
+// Half precision for finite values in [0, 65504). Round to nearest, ties
+// away from zero; subnormals round up into the smallest normal.
+std::uint16_t halfFromDouble(double x) {
+    if (x < 0x1p-14) return static_cast<std::uint16_t>(std::lround(x * 0x1p24));
+    int exponent;
+    const double fraction = std::frexp(x, &exponent);  // x = fraction * 2^exponent, fraction in [0.5, 1)
+    long mantissa = std::lround((2.0 * fraction - 1.0) * 1024.0);
+    if (mantissa == 1024) {
+        mantissa = 0;
+        ++exponent;
+    }
+    return static_cast<std::uint16_t>(((exponent + 14) << 10) | mantissa);
+}
+
+// Branch-free decode for non-negative finite halves (normal or subnormal):
+// shifting into float position and multiplying by 2^112 rebiases the
+// exponent, so the decode loop vectorises.
+inline float floatFromHalf(std::uint16_t h) {
+    return std::bit_cast<float>(static_cast<std::uint32_t>(h) << 13) * 0x1p112f;
+}
+
+struct CodeHash {
+    std::size_t operator()(const std::vector<std::uint16_t>& codes) const {
+        std::uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a
+        for (std::uint16_t c : codes) h = (h ^ c) * 0x100000001b3ULL;
+        return static_cast<std::size_t>(h);
+    }
+};
+
+constexpr std::uint32_t kStoreMagic = 0x53535442;  // "BTSS"
+constexpr std::uint32_t kStoreVersion = 2;  // 2 adds per-node missing-left flags
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeVector(std::ostream& out, const std::vector<T>& v) {
+    writePod(out, static_cast<std::uint64_t>(v.size()));
+    out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+template <typename T>
+T readPod(std::istream& in) {
+    T value{};
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+        throw std::runtime_error("Truncated sampled tree store");
+    return value;
+}
+
+template <typename T>
+std::vector<T> readVector(std::istream& in) {
+    const auto size = readPod<std::uint64_t>(in);
+    std::vector<T> v;
+    // Grow in chunks so a corrupt size cannot trigger one huge allocation
+    constexpr std::uint64_t kChunk = 1 << 16;
+    for (std::uint64_t done = 0; done < size;) {
+        const std::uint64_t n = std::min(kChunk, size - done);
+        v.resize(done + n);
+        if (!in.read(reinterpret_cast<char*>(v.data() + done), static_cast<std::streamsize>(n * sizeof(T))))
+            throw std::runtime_error("Truncated sampled tree store");
+        done += n;
+    }
+    return v;
+}
+
+}  // namespace
+
+// ======== CounterRng ========
+
+CounterRng::CounterRng(std::uint64_t seed, std::uint64_t stream)
+    : key_(splitMix64(seed ^ splitMix64(stream + kGoldenGamma)))
+{
+}
+
+std::uint64_t CounterRng::next() {
+    return splitMix64(key_ + (++counter_) * kGoldenGamma);
+}
+
+double CounterRng::uniform() {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+int CounterRng::uniformInt(int n) {
+    return static_cast<int>(uniform() * n);
+}
+
+// ======== SampledTreeStore ========
+
+void SampledTreeStore::clear(int num_classes) {
+    num_classes_ = num_classes;
+    tree_offset_.clear();
+    weight_.clear();
+    total_weight_ = 0;
+    num_features_used_ = 0;
+    feature_.clear();
+    threshold_.clear();
+    left_.clear();
+    right_.clear();
+    missing_left_.clear();
+    leaf_probs_.clear();
+    leaf_format_ = LeafFormat::Double;
+    tree_scale_.clear();
+    leaf_codes_.clear();
+}
+
+int SampledTreeStore::addTree(const std::vector<int>& feature, const std::vector<double>& threshold,
+                              const std::vector<int>& left, const std::vector<int>& right,
+                              const std::vector<double>& leaf_probs,
+                              const std::vector<std::uint8_t>& missing_left) {
+    if (leaf_format_ != LeafFormat::Double)
+        throw std::logic_error("Cannot add trees to a store with compressed leaves");
+    const auto leaf_base = static_cast<std::int32_t>(leaf_probs_.size() / num_classes_);
+
+    tree_offset_.push_back(static_cast<std::uint32_t>(feature_.size()));
+    weight_.push_back(1);
+    ++total_weight_;
+
+    for (std::size_t i = 0; i < feature.size(); ++i) {
+        num_features_used_ = std::max(num_features_used_, feature[i] + 1);
+        feature_.push_back(feature[i]);
+        threshold_.push_back(threshold[i]);
+        left_.push_back(feature[i] < 0 ? leaf_base + left[i] : left[i]);
+        right_.push_back(right[i]);
+        missing_left_.push_back(i < missing_left.size() && feature[i] >= 0 ? missing_left[i] != 0 : 0);
+    }
+    leaf_probs_.insert(leaf_probs_.end(), leaf_probs.begin(), leaf_probs.end());
+    return static_cast<int>(tree_offset_.size()) - 1;
+}
+
+void SampledTreeStore::addWeight(int tree, std::uint32_t weight) {
+    weight_[tree] += weight;
+    total_weight_ += weight;
+}
+
+void SampledTreeStore::merge(const SampledTreeStore& other) {
+    if (other.numTrees() == 0) return;
+    if (num_classes_ != other.num_classes_)
+        throw std::invalid_argument("Cannot merge stores with different numbers of classes");
+    if (leaf_format_ != LeafFormat::Double || other.leaf_format_ != LeafFormat::Double)
+        throw std::logic_error("Cannot merge stores with compressed leaves");
+
+    const auto node_base = static_cast<std::uint32_t>(feature_.size());
+    const auto leaf_base = static_cast<std::int32_t>(leaf_probs_.size() / num_classes_);
+
+    for (std::uint32_t offset : other.tree_offset_) tree_offset_.push_back(node_base + offset);
+    weight_.insert(weight_.end(), other.weight_.begin(), other.weight_.end());
+    total_weight_ += other.total_weight_;
+    num_features_used_ = std::max(num_features_used_, other.num_features_used_);
+
+    for (std::size_t i = 0; i < other.feature_.size(); ++i) {
+        feature_.push_back(other.feature_[i]);
+        threshold_.push_back(other.threshold_[i]);
+        left_.push_back(other.feature_[i] < 0 ? leaf_base + other.left_[i] : other.left_[i]);
+        right_.push_back(other.right_[i]);
+    }
+    missing_left_.insert(missing_left_.end(), other.missing_left_.begin(), other.missing_left_.end());
+    leaf_probs_.insert(leaf_probs_.end(), other.leaf_probs_.begin(), other.leaf_probs_.end());
+}
+
+// Leaf slots of tree t are rewritten to dictionary entries. UInt16 codes
+// are relative to the largest leaf probability of the tree, so every tree
+// uses the full code range; Float16 needs no scale.
+void SampledTreeStore::compressLeaves(LeafFormat format) {
+    if (format == LeafFormat::Double) return;
+    if (leaf_format_ != LeafFormat::Double)
+        throw std::logic_error("Leaves are already compressed");
+
+    const int K = num_classes_;
+    std::unordered_map<std::vector<std::uint16_t>, std::int32_t, CodeHash> dictionary;
+    std::vector<std::uint16_t> codes(K);
+    tree_scale_.assign(tree_offset_.size(), 1.0);
+    leaf_codes_.clear();
+
+    for (std::size_t t = 0; t < tree_offset_.size(); ++t) {
+        const std::size_t begin = tree_offset_[t];
+        const std::size_t end = t + 1 < tree_offset_.size() ? tree_offset_[t + 1] : feature_.size();
+
+        if (format == LeafFormat::UInt16) {
+            double max_prob = 0.0;
+            for (std::size_t node = begin; node < end; ++node) {
+                if (feature_[node] >= 0) continue;
+                const double* p = leaf_probs_.data() + static_cast<std::size_t>(left_[node]) * K;
+                for (int k = 0; k < K; ++k) max_prob = std::max(max_prob, p[k]);
+            }
+            if (max_prob > 0.0) tree_scale_[t] = max_prob / 65535.0;
+        }
+
+        const double inv_scale = 1.0 / tree_scale_[t];
+        for (std::size_t node = begin; node < end; ++node) {
+            if (feature_[node] >= 0) continue;
+            const double* p = leaf_probs_.data() + static_cast<std::size_t>(left_[node]) * K;
+            for (int k = 0; k < K; ++k) {
+                codes[k] = format == LeafFormat::UInt16
+                    ? static_cast<std::uint16_t>(std::lround(p[k] * inv_scale))
+                    : halfFromDouble(p[k]);
+            }
+
+            const auto entry = static_cast<std::int32_t>(leaf_codes_.size() / K);
+            const auto [it, inserted] = dictionary.try_emplace(codes, entry);
+            if (inserted) leaf_codes_.insert(leaf_codes_.end(), codes.begin(), codes.end());
+            left_[node] = it->second;
+        }
+    }
+
+    leaf_probs_.clear();
+    leaf_probs_.shrink_to_fit();
+    leaf_codes_.shrink_to_fit();
+    leaf_format_ = format;
+}
+
+std::size_t SampledTreeStore::numTrees() const {
+    return tree_offset_.size();
+}
+
+std::uint64_t SampledTreeStore::totalWeight() const {
+    return total_weight_;
+}
+
+std::size_t SampledTreeStore::memoryBytes() const {
+    return tree_offset_.size() * sizeof(std::uint32_t)
+         + weight_.size() * sizeof(std::uint32_t)
+         + feature_.size() * sizeof(std::int32_t)
+         + threshold_.size() * sizeof(double)
+         + left_.size() * sizeof(std::int32_t)
+         + right_.size() * sizeof(std::int32_t)
+         + leaf_probs_.size() * sizeof(double)
+         + tree_scale_.size() * sizeof(double)
+         + leaf_codes_.size() * sizeof(std::uint16_t);
+}
+
+LeafFormat SampledTreeStore::getLeafFormat() const {
+    return leaf_format_;
+}
+
+std::size_t SampledTreeStore::numLeafEntries() const {
+    if (num_classes_ == 0) return 0;
+    return (leaf_format_ == LeafFormat::Double ? leaf_probs_.size() : leaf_codes_.size()) / num_classes_;
+}
+
+std::vector<double> SampledTreeStore::predictProba(const std::vector<double>& x) const {
+    std::vector<double> probs(num_classes_);
+    predictProbaBatch(x.data(), 1, x.size(), probs.data());
+    return probs;
+}
+
+// Tree-major: each tree walks every row while its nodes are hot in cache.
+// Every row still accumulates the trees in index order, so a row's result
+// does not depend on the batch it is scored in.
+void SampledTreeStore::predictProbaBatch(const double* X, std::size_t num_rows,
+                                         std::size_t row_stride, double* probs) const {
+    if (total_weight_ == 0)
+        throw std::logic_error("No sampled trees stored");
+    if (row_stride < static_cast<std::size_t>(num_features_used_))
+        throw std::invalid_argument("Input dimension mismatch");
+
+    const int K = num_classes_;
+    std::fill(probs, probs + num_rows * K, 0.0);
+    for (std::size_t t = 0; t < tree_offset_.size(); ++t) {
+        const std::uint32_t base = tree_offset_[t];
+        const double w = weight_[t];
+        for (std::size_t i = 0; i < num_rows; ++i) {
+            const double* x = X + i * row_stride;
+            double* p = probs + i * K;
+            std::uint32_t node = base;
+            while (feature_[node] >= 0) {
+                const double v = x[feature_[node]];
+                const bool go_left = v <= threshold_[node] || (missing_left_[node] && std::isnan(v));
+                node = base + (go_left ? left_[node] : right_[node]);
+            }
+
+            const std::size_t slot = static_cast<std::size_t>(left_[node]) * K;
+            switch (leaf_format_) {
+            case LeafFormat::Double: {
+                const double* leaf = leaf_probs_.data() + slot;
+                for (int k = 0; k < K; ++k) p[k] += w * leaf[k];
+                break;
+            }
+            case LeafFormat::UInt16: {
+                const std::uint16_t* codes = leaf_codes_.data() + slot;
+                const double ws = w * tree_scale_[t];
+                for (int k = 0; k < K; ++k) p[k] += ws * codes[k];
+                break;
+            }
+            case LeafFormat::Float16: {
+                const std::uint16_t* codes = leaf_codes_.data() + slot;
+                for (int k = 0; k < K; ++k) p[k] += w * floatFromHalf(codes[k]);
+                break;
+            }
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < num_rows; ++i) {
+        double* p = probs + i * K;
+        // Quantised leaves no longer sum to exactly one
+        double total = static_cast<double>(total_weight_);
+        if (leaf_format_ != LeafFormat::Double) {
+            total = 0.0;
+            for (int k = 0; k < K; ++k) total += p[k];
+        }
+        const double inv_total = 1.0 / total;
+        for (int k = 0; k < K; ++k) p[k] *= inv_total;
+    }
+}
+
+int SampledTreeStore::getNumFeaturesUsed() const {
+    return num_features_used_;
+}
+
+int SampledTreeStore::getNumClasses() const {
+    return num_classes_;
+}
+
+const std::vector<std::uint32_t>& SampledTreeStore::getTreeOffsets() const {
+    return tree_offset_;
+}
+
+const std::vector<std::uint32_t>& SampledTreeStore::getWeights() const {
+    return weight_;
+}
+
+const std::vector<std::int32_t>& SampledTreeStore::getFeatures() const {
+    return feature_;
+}
+
+const std::vector<double>& SampledTreeStore::getThresholds() const {
+    return threshold_;
+}
+
+const std::vector<std::int32_t>& SampledTreeStore::getLeft() const {
+    return left_;
+}
+
+const std::vector<std::int32_t>& SampledTreeStore::getRight() const {
+    return right_;
+}
+
+const std::vector<std::uint8_t>& SampledTreeStore::getMissingLeft() const {
+    return missing_left_;
+}
+
+const std::vector<double>& SampledTreeStore::getLeafProbs() const {
+    return leaf_probs_;
+}
+
+void SampledTreeStore::save(std::ostream& out) const {
+    writePod(out, kStoreMagic);
+    writePod(out, kStoreVersion);
+    writePod(out, static_cast<std::int32_t>(num_classes_));
+    writePod(out, leaf_format_);
+    writeVector(out, tree_offset_);
+    writeVector(out, weight_);
+    writeVector(out, feature_);
+    writeVector(out, threshold_);
+    writeVector(out, left_);
+    writeVector(out, right_);
+    writeVector(out, missing_left_);
+    if (leaf_format_ == LeafFormat::Double) {
+        writeVector(out, leaf_probs_);
+    } else {
+        writeVector(out, tree_scale_);
+        writeVector(out, leaf_codes_);
+    }
+    if (!out)
+        throw std::runtime_error("Failed to write sampled tree store");
+}
+
+SampledTreeStore SampledTreeStore::load(std::istream& in) {
+    if (readPod<std::uint32_t>(in) != kStoreMagic)
+        throw std::runtime_error("Not a sampled tree store");
+    const auto version = readPod<std::uint32_t>(in);
+    if (version < 1 || version > kStoreVersion)
+        throw std::runtime_error("Unsupported sampled tree store version");
+
+    SampledTreeStore store;
+    store.num_classes_ = readPod<std::int32_t>(in);
+    store.leaf_format_ = readPod<LeafFormat>(in);
+    if (store.num_classes_ < 1 || store.leaf_format_ > LeafFormat::UInt16)
+        throw std::runtime_error("Corrupt sampled tree store header");
+
+    store.tree_offset_ = readVector<std::uint32_t>(in);
+    store.weight_ = readVector<std::uint32_t>(in);
+    store.feature_ = readVector<std::int32_t>(in);
+    store.threshold_ = readVector<double>(in);
+    store.left_ = readVector<std::int32_t>(in);
+    store.right_ = readVector<std::int32_t>(in);
+    // Version 1 files predate missing-left flags: missing values go right
+    if (version >= 2)
+        store.missing_left_ = readVector<std::uint8_t>(in);
+    else
+        store.missing_left_.assign(store.feature_.size(), 0);
+    if (store.leaf_format_ == LeafFormat::Double) {
+        store.leaf_probs_ = readVector<double>(in);
+    } else {
+        store.tree_scale_ = readVector<double>(in);
+        store.leaf_codes_ = readVector<std::uint16_t>(in);
+    }
+
+    const std::size_t num_nodes = store.feature_.size();
+    if (store.weight_.size() != store.tree_offset_.size() || store.threshold_.size() != num_nodes
+        || store.left_.size() != num_nodes || store.right_.size() != num_nodes
+        || store.missing_left_.size() != num_nodes
+        || (store.leaf_format_ != LeafFormat::Double && store.tree_scale_.size() != store.tree_offset_.size())
+        || store.leaf_probs_.size() % store.num_classes_ != 0
+        || store.leaf_codes_.size() % store.num_classes_ != 0)
+        throw std::runtime_error("Corrupt sampled tree store arrays");
+
+    const std::size_t num_entries = store.numLeafEntries();
+    for (std::size_t t = 0; t < store.tree_offset_.size(); ++t) {
+        const std::size_t begin = store.tree_offset_[t];
+        const std::size_t end = t + 1 < store.tree_offset_.size() ? store.tree_offset_[t + 1] : num_nodes;
+        if (begin >= end || end > num_nodes)
+            throw std::runtime_error("Corrupt sampled tree store offsets");
+        // Children must point forward within the tree, so every walk from
+        // the root ends at a leaf
+        for (std::size_t node = begin; node < end; ++node) {
+            const std::int64_t local = static_cast<std::int64_t>(node - begin);
+            const bool ok = store.feature_[node] < 0
+                ? store.left_[node] >= 0 && static_cast<std::size_t>(store.left_[node]) < num_entries
+                : store.left_[node] > local && store.right_[node] > local
+                  && begin + store.left_[node] < end && begin + store.right_[node] < end;
+            if (!ok)
+                throw std::runtime_error("Corrupt sampled tree store nodes");
+        }
+    }
+
+    for (std::uint32_t w : store.weight_) store.total_weight_ += w;
+    if (store.total_weight_ == 0)
+        throw std::runtime_error("Sampled tree store holds no weighted trees");
+    for (std::int32_t f : store.feature_) store.num_features_used_ = std::max(store.num_features_used_, f + 1);
+    return store;
+}
+
+// ======== TreeSampler::Chain ========
+
+// One Metropolis-Hastings chain over tree structures. Every node caches its
+// class counts and marginal log likelihood; leaves also own their row
+// indices, so the leaves partition the training rows (O(N) memory).
+class TreeSampler::Chain {
+public:
+    Chain(const BinnedData& data, const std::vector<int>& y,
+          const ConjugateCategoricalDirichlet& prior, const TreeSamplerParams& params,
+          int num_classes, int chain_index)
+        : data_(data), y_(y), prior_(prior), params_(params)
+        , num_classes_(num_classes), rng_(params.seed, static_cast<std::uint64_t>(chain_index))
+    {
+        cut_offset_.assign(data_.numFeatures() + 1, 0);
+        for (int f = 0; f < data_.numFeatures(); ++f)
+            cut_offset_[f + 1] = cut_offset_[f] + data_.numBins(f) - 1;
+
+        SNode root;
+        root.rows.resize(data_.numRows());
+        root.counts.assign(num_classes_, 0);
+        for (int i = 0; i < data_.numRows(); ++i) {
+            root.rows[i] = i;
+            ++root.counts[y_[i]];
+        }
+        root.log_likelihood = leafLogLikelihood(root.counts);
+        total_log_likelihood_ = root.log_likelihood;
+        nodes_.push_back(std::move(root));
+    }
+
+    void run(SampledTreeStore& store, ChainReport& report) {
+        report_ = &report;
+        store.clear(num_classes_);
+
+        std::uint64_t stored_version = std::numeric_limits<std::uint64_t>::max();
+        int stored_index = -1;
+        const int thin = std::max(1, params_.thin);
+
+        for (int it = 0; it < params_.num_iterations; ++it) {
+            step();
+            report.log_likelihood_trace.push_back(total_log_likelihood_);
+            report.num_leaves_trace.push_back(num_leaves_);
+
+            if (it < params_.burn_in || (it - params_.burn_in) % thin != 0) continue;
+            if (version_ == stored_version) {
+                store.addWeight(stored_index);
+            } else {
+                stored_index = storeTree(store);
+                stored_version = version_;
+            }
+        }
+        report_ = nullptr;
+    }
+
+private:
+    struct SNode {
+        int feature = -1;
+        int bin = -1;
+        int left = -1;
+        int right = -1;
+        int parent = -1;
+        int depth = 0;
+        std::vector<int> counts;
+        double log_likelihood = 0.0;
+        std::vector<int> rows;  // Leaves only
+    };
+
+    struct Proposal {
+        std::vector<int> left_rows, right_rows;
+        std::vector<int> left_counts, right_counts;
+        double left_ll = 0.0, right_ll = 0.0;
+    };
+
+    struct MoveProbs {
+        double grow, prune, change;
+    };
+
+    bool isLeaf(int i) const { return nodes_[i].left < 0; }
+
+    // Internal node whose children are both leaves
+    bool isNog(int i) const {
+        return !isLeaf(i) && isLeaf(nodes_[i].left) && isLeaf(nodes_[i].right);
+    }
+
+    static MoveProbs moveProbs(int num_nogs) {
+        if (num_nogs == 0) return {1.0, 0.0, 0.0};
+        return {0.4, 0.4, 0.2};
+    }
+
+    double logPSplit(int depth) const {
+        if (depth >= params_.max_depth) return kNegInf;
+        return std::log(params_.split_alpha) - params_.split_beta * std::log1p(depth);
+    }
+
+    double log1mPSplit(int depth) const {
+        if (depth >= params_.max_depth) return 0.0;
+        return std::log1p(-params_.split_alpha * std::pow(1.0 + depth, -params_.split_beta));
+    }
+
+    // Tree-prior log ratio of splitting a leaf at `depth` into two leaves
+    double logSplitPriorRatio(int depth) const {
+        return logPSplit(depth) + 2.0 * log1mPSplit(depth + 1) - log1mPSplit(depth);
+    }
+
+    double leafLogLikelihood(const std::vector<int>& counts) {
+        ++report_likelihoods_;
+        return prior_.getLogLikelihoodFromObservationsUnchecked(counts);
+    }
+
+    void collect() {
+        leaves_.clear();
+        nogs_.clear();
+        for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+            if (nodes_[i].parent < 0 && i != 0) continue;  // Free slot
+            if (isLeaf(i)) leaves_.push_back(i);
+            else if (isNog(i)) nogs_.push_back(i);
+        }
+        num_leaves_ = static_cast<int>(leaves_.size());
+    }
+
+    // Draw a split rule uniformly over all (feature, bin) cut points
+    bool drawRule(int& feature, int& bin) {
+        const int total_cuts = cut_offset_.back();
+        if (total_cuts == 0) return false;
+        const int r = rng_.uniformInt(total_cuts);
+        feature = static_cast<int>(
+            std::upper_bound(cut_offset_.begin(), cut_offset_.end(), r) - cut_offset_.begin()) - 1;
+        bin = r - cut_offset_[feature];
+        return true;
+    }
+
+    // Split rows by bins[feature] <= bin and score both sides. Returns false
+    // if a side is smaller than min_samples_leaf.
+    bool propose(const std::vector<int>& rows, int feature, int bin, Proposal& p) {
+        const BinnedData::Bin* col = data_.column(feature);
+        p.left_rows.clear();
+        p.right_rows.clear();
+        p.left_counts.assign(num_classes_, 0);
+        p.right_counts.assign(num_classes_, 0);
+        for (int r : rows) {
+            if (col[r] <= bin) {
+                p.left_rows.push_back(r);
+                ++p.left_counts[y_[r]];
+            } else {
+                p.right_rows.push_back(r);
+                ++p.right_counts[y_[r]];
+            }
+        }
+        const int min_leaf = std::max(1, params_.min_samples_leaf);
+        if (static_cast<int>(p.left_rows.size()) < min_leaf ||
+            static_cast<int>(p.right_rows.size()) < min_leaf)
+            return false;
+
+        p.left_ll = leafLogLikelihood(p.left_counts);
+        p.right_ll = leafLogLikelihood(p.right_counts);
+        return true;
+    }
+
+    bool accept(double log_ratio) {
+        return std::log(rng_.uniform()) < log_ratio;
+    }
+
+    int allocNode() {
+        if (!free_.empty()) {
+            int i = free_.back();
+            free_.pop_back();
+            return i;
+        }
+        nodes_.emplace_back();
+        return static_cast<int>(nodes_.size()) - 1;
+    }
+
+    void releaseNode(int i) {
+        nodes_[i] = SNode{};
+        free_.push_back(i);
+    }
+
+    void step() {
+        collect();
+        const MoveProbs probs = moveProbs(static_cast<int>(nogs_.size()));
+        const double u = rng_.uniform();
+        if (u < probs.grow) grow(probs);
+        else if (u < probs.grow + probs.prune) prune(probs);
+        else change();
+        report_->leaf_likelihood_evaluations += report_likelihoods_;
+        report_likelihoods_ = 0;
+    }
+
+    void grow(const MoveProbs& probs) {
+        ++report_->grow_proposed;
+        const int L = static_cast<int>(leaves_.size());
+        const int eta = leaves_[rng_.uniformInt(L)];
+        const int depth = nodes_[eta].depth;
+        if (depth >= params_.max_depth) return;
+
+        int feature, bin;
+        if (!drawRule(feature, bin)) return;
+        if (!propose(nodes_[eta].rows, feature, bin, proposal_)) return;
+
+        // Nog count after the move: eta becomes a nog, its parent stops being one
+        const int parent = nodes_[eta].parent;
+        const int new_nogs = static_cast<int>(nogs_.size()) + 1 - (parent >= 0 && isNog(parent) ? 1 : 0);
+
+        const double delta_ll = proposal_.left_ll + proposal_.right_ll - nodes_[eta].log_likelihood;
+        const double log_ratio = delta_ll + logSplitPriorRatio(depth)
+                               + std::log(moveProbs(new_nogs).prune) - std::log(probs.grow)
+                               + std::log(static_cast<double>(L)) - std::log(static_cast<double>(new_nogs));
+        if (!accept(log_ratio)) return;
+
+        ++report_->grow_accepted;
+        const int left = allocNode();
+        const int right = allocNode();
+        for (int child : {left, right}) {
+            const bool is_left = child == left;
+            SNode& c = nodes_[child];
+            c.parent = eta;
+            c.depth = depth + 1;
+            c.rows = std::move(is_left ? proposal_.left_rows : proposal_.right_rows);
+            c.counts = std::move(is_left ? proposal_.left_counts : proposal_.right_counts);
+            c.log_likelihood = is_left ? proposal_.left_ll : proposal_.right_ll;
+        }
+        SNode& n = nodes_[eta];
+        n.feature = feature;
+        n.bin = bin;
+        n.left = left;
+        n.right = right;
+        n.rows.clear();
+        n.rows.shrink_to_fit();
+
+        total_log_likelihood_ += delta_ll;
+        ++version_;
+    }
+
+    void prune(const MoveProbs& probs) {
+        ++report_->prune_proposed;
+        const int W = static_cast<int>(nogs_.size());
+        const int eta = nogs_[rng_.uniformInt(W)];
+        const SNode& n = nodes_[eta];
+        const int depth = n.depth;
+
+        // After the move eta is a leaf; its parent becomes a nog if eta's sibling is a leaf
+        const int new_leaves = static_cast<int>(leaves_.size()) - 1;
+        int new_nogs = W - 1;
+        if (n.parent >= 0) {
+            const SNode& p = nodes_[n.parent];
+            const int sibling = p.left == eta ? p.right : p.left;
+            if (isLeaf(sibling)) ++new_nogs;
+        }
+
+        const double delta_ll = nodes_[n.left].log_likelihood + nodes_[n.right].log_likelihood
+                              - n.log_likelihood;
+        const double log_ratio = -delta_ll - logSplitPriorRatio(depth)
+                               + std::log(moveProbs(new_nogs).grow) - std::log(probs.prune)
+                               + std::log(static_cast<double>(W)) - std::log(static_cast<double>(new_leaves));
+        if (!accept(log_ratio)) return;
+
+        ++report_->prune_accepted;
+        SNode& m = nodes_[eta];
+        auto& left_rows = nodes_[m.left].rows;
+        auto& right_rows = nodes_[m.right].rows;
+        m.rows.reserve(left_rows.size() + right_rows.size());
+        m.rows.insert(m.rows.end(), left_rows.begin(), left_rows.end());
+        m.rows.insert(m.rows.end(), right_rows.begin(), right_rows.end());
+        releaseNode(m.left);
+        releaseNode(m.right);
+        m.feature = -1;
+        m.bin = -1;
+        m.left = -1;
+        m.right = -1;
+
+        total_log_likelihood_ -= delta_ll;
+        ++version_;
+    }
+
+    void change() {
+        ++report_->change_proposed;
+        const int eta = nogs_[rng_.uniformInt(static_cast<int>(nogs_.size()))];
+
+        int feature, bin;
+        if (!drawRule(feature, bin)) return;
+
+        const SNode& n = nodes_[eta];
+        const SNode& l = nodes_[n.left];
+        const SNode& r = nodes_[n.right];
+        rows_scratch_.assign(l.rows.begin(), l.rows.end());
+        rows_scratch_.insert(rows_scratch_.end(), r.rows.begin(), r.rows.end());
+        if (!propose(rows_scratch_, feature, bin, proposal_)) return;
+
+        // Uniform rule prior and symmetric proposal: only the two leaves change
+        const double delta_ll = proposal_.left_ll + proposal_.right_ll
+                              - l.log_likelihood - r.log_likelihood;
+        if (!accept(delta_ll)) return;
+
+        ++report_->change_accepted;
+        SNode& m = nodes_[eta];
+        m.feature = feature;
+        m.bin = bin;
+        SNode& nl = nodes_[m.left];
+        SNode& nr = nodes_[m.right];
+        nl.rows = std::move(proposal_.left_rows);
+        nl.counts = std::move(proposal_.left_counts);
+        nl.log_likelihood = proposal_.left_ll;
+        nr.rows = std::move(proposal_.right_rows);
+        nr.counts = std::move(proposal_.right_counts);
+        nr.log_likelihood = proposal_.right_ll;
+
+        total_log_likelihood_ += delta_ll;
+        ++version_;
+    }
+
+    // Pack the current tree into the store (depth-first, root first)
+    int storeTree(SampledTreeStore& store) {
+        std::vector<int> feature, left, right;
+        std::vector<double> threshold, leaf_probs;
+        const auto& prior_alphas = prior_.getParameterDistribution().getAlpha();
+
+        std::vector<int> local(nodes_.size(), -1);
+        std::vector<int> stack{0};
+        std::vector<int> order;
+        while (!stack.empty()) {
+            const int i = stack.back();
+            stack.pop_back();
+            local[i] = static_cast<int>(order.size());
+            order.push_back(i);
+            if (!isLeaf(i)) {
+                stack.push_back(nodes_[i].right);
+                stack.push_back(nodes_[i].left);
+            }
+        }
+
+        int num_leaves = 0;
+        for (int i : order) {
+            const SNode& n = nodes_[i];
+            if (isLeaf(i)) {
+                feature.push_back(-1);
+                threshold.push_back(0.0);
+                left.push_back(num_leaves++);
+                right.push_back(-1);
+
+                double total = 0.0;
+                for (int k = 0; k < num_classes_; ++k) total += prior_alphas[k] + n.counts[k];
+                for (int k = 0; k < num_classes_; ++k)
+                    leaf_probs.push_back((prior_alphas[k] + n.counts[k]) / total);
+            } else {
+                feature.push_back(n.feature);
+                threshold.push_back(data_.threshold(n.feature, n.bin));
+                left.push_back(local[n.left]);
+                right.push_back(local[n.right]);
+            }
+        }
+        return store.addTree(feature, threshold, left, right, leaf_probs);
+    }
+
+    const BinnedData& data_;
+    const std::vector<int>& y_;
+    const ConjugateCategoricalDirichlet& prior_;
+    const TreeSamplerParams& params_;
+    const int num_classes_;
+    CounterRng rng_;
+
+    std::vector<int> cut_offset_;  // Prefix sums of cut points per feature
+    std::vector<SNode> nodes_;
+    std::vector<int> free_;
+    std::vector<int> leaves_, nogs_;
+    std::vector<int> rows_scratch_;
+    Proposal proposal_;
+
+    double total_log_likelihood_ = 0.0;
+    int num_leaves_ = 1;
+    std::uint64_t version_ = 0;  // Bumped on every accepted move
+    std::uint64_t report_likelihoods_ = 0;
+    ChainReport* report_ = nullptr;
+};
+
+// ======== TreeSampler ========
+
+TreeSampler::TreeSampler() : TreeSampler(TreeSamplerParams{}) {}
+
+TreeSampler::TreeSampler(const TreeSamplerParams& params) : params_(params) {
+    if (params_.num_chains < 1)
+        throw std::invalid_argument("num_chains must be positive");
+    if (params_.burn_in < 0 || params_.burn_in >= params_.num_iterations)
+        throw std::invalid_argument("burn_in must be in [0, num_iterations)");
+    if (params_.split_alpha <= 0.0 || params_.split_alpha >= 1.0)
+        throw std::invalid_argument("split_alpha must be in (0, 1)");
+    if (params_.prior_alpha <= 0.0)
+        throw std::invalid_argument("prior_alpha must be positive");
+}
+
+void TreeSampler::fit(const FeatureMatrix& X, const std::vector<int>& y, int num_classes) {
+    if (X.size() != y.size())
+        throw std::invalid_argument("X and y must have the same number of rows");
+    if (y.empty())
+        throw std::invalid_argument("Training data cannot be empty");
+
+    int max_label = *std::max_element(y.begin(), y.end());
+    if (*std::min_element(y.begin(), y.end()) < 0)
+        throw std::invalid_argument("Class labels must be non-negative");
+    num_classes_ = num_classes > 0 ? num_classes : max_label + 1;
+    if (max_label >= num_classes_)
+        throw std::invalid_argument("Class label out of range for num_classes");
+    num_classes_ = std::max(num_classes_, 2);
+
+    if (params_.prior_alpha == 0.5)
+        prior_.initialise(num_classes_);
+    else
+        prior_.initialise(num_classes_, params_.prior_alpha);
+
+    const BinnedData data(X, params_.max_bins);
+    num_features_ = data.numFeatures();
+
+    reports_.assign(params_.num_chains, ChainReport{});
+    std::vector<SampledTreeStore> chain_samples(params_.num_chains);
+
+    parallelFor(params_.num_chains, params_.num_threads, [&](int c, int) {
+        reports_[c].chain = c;
+        Chain chain(data, y, prior_, params_, num_classes_, c);
+        chain.run(chain_samples[c], reports_[c]);
+    });
+
+    samples_.clear(num_classes_);
+    for (const auto& s : chain_samples) samples_.merge(s);
+    samples_.compressLeaves(params_.leaf_format);
+}
+
+std::vector<double> TreeSampler::predictProba(const std::vector<double>& x) const {
+    if (static_cast<int>(x.size()) != num_features_)
+        throw std::invalid_argument("Input dimension mismatch");
+    return samples_.predictProba(x);
+}
+
+std::vector<std::vector<double>> TreeSampler::predictProba(const FeatureMatrix& X) const {
+    std::vector<std::vector<double>> out;
+    out.reserve(X.size());
+    for (const auto& row : X) out.push_back(predictProba(row));
+    return out;
+}
+
+const SampledTreeStore& TreeSampler::getSamples() const {
+    return samples_;
+}
+
+const std::vector<ChainReport>& TreeSampler::getChainReports() const {
+    return reports_;
+}
+
+const TreeSamplerParams& TreeSampler::getParams() const {
+    return params_;
+}
+
+int TreeSampler::getNumClasses() const {
+    return num_classes_;
+}
@@ -58,6 +58,25 @@ TEST_F(CategoricalDistributionLogLikelihoodTest, ImpossibleEventZeroProbabilityW
     EXPECT_LT(ll_bad, 0);
 }
 
+// Unchecked fast paths must agree with the checked API
+class CategoricalDistributionUncheckedTest : public ::testing::Test {
+protected:
+    std::vector<double> probs = {0.2, 0.3, 0.5};
+    CategoricalDistribution dist{probs};
+};
+
+TEST_F(CategoricalDistributionUncheckedTest, SetProbsUncheckedNormalises) {
+    dist.set_probs_unchecked({2.0, 2.0, 4.0});
+    EXPECT_NEAR(dist.probs()[0], 0.25, 1e-12);
+    EXPECT_NEAR(dist.probs()[1], 0.25, 1e-12);
+    EXPECT_NEAR(dist.probs()[2], 0.5, 1e-12);
+}
+
+TEST_F(CategoricalDistributionUncheckedTest, LogLikelihoodUncheckedMatchesChecked) {
+    std::vector<int> counts = {2, 0, 3};
+    EXPECT_DOUBLE_EQ(dist.log_likelihood_unchecked(counts), dist.log_likelihood(counts));
+}
+
 
 // 
 // #include <cassert>
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include "bayes_tree/codegen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+// Class is 1 iff x0 > 0.5 with label noise, x1 carries a weaker signal
+void makeData(int n, BayesTree::FeatureMatrix& X, std::vector<int>& y) {
+    X.clear();
+    y.clear();
+    for (int i = 0; i < n; ++i) {
+        double x0 = (i % 20) / 20.0;
+        double x1 = ((i * 37) % 101) / 101.0;
+        X.push_back({x0, x1});
+        int label = x0 > 0.5 ? 1 : 0;
+        if (i % 9 == 0 && x1 > 0.3) label = 1 - label;
+        if (i % 13 == 0) label = 2;
+        y.push_back(label);
+    }
+}
+
+// Write, compile and load a generated model in a fresh temporary directory
+CompiledModel buildModel(const std::string& source, const std::string& name) {
+    const auto dir = std::filesystem::temp_directory_path() / "bayes_tree_codegen_test";
+    std::filesystem::create_directories(dir);
+    const auto source_path = (dir / (name + ".cpp")).string();
+    const auto library_path = (dir / (name + ".so")).string();
+    std::ofstream(source_path) << source;
+    compileSharedObject(source_path, library_path, BAYES_TREE_CXX_COMPILER);
+    return CompiledModel(library_path);
+}
+
+}  // namespace
+
+// Test suite for generated single-tree models
+class CodegenTest : public ::testing::Test {
+protected:
+    void SetUp() override { makeData(600, X, y); }
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+};
+
+TEST_F(CodegenTest, FlatStoreMatchesTree) {
+    BayesTree tree;
+    tree.fit(X, y);
+    const SampledTreeStore store = toSampledTreeStore(tree);
+    EXPECT_EQ(store.numTrees(), 1u);
+    for (const auto& row : X) EXPECT_EQ(store.predictProba(row), tree.predictProba(row));
+}
+
+TEST_F(CodegenTest, GeneratedTreeMatchesInterpreterInBothForms) {
+    BayesTreeParams params;
+    params.max_depth = 6;
+    BayesTree tree(params);
+    tree.fit(X, y);
+    ASSERT_GT(tree.getDepth(), 1);
+    const SampledTreeStore store = toSampledTreeStore(tree);
+
+    CodegenParams nested;
+    nested.max_branchless_depth = 0;
+    CodegenParams branchless;
+    branchless.max_branchless_depth = 16;
+    int index = 0;
+    for (const auto& codegen : {nested, branchless}) {
+        const std::string source = generateModelSource(tree, codegen);
+        EXPECT_NE(source.find("constexpr double kLeaves0"), std::string::npos);
+        const CompiledModel model = buildModel(source, "tree" + std::to_string(index++));
+        EXPECT_EQ(model.getNumClasses(), 3);
+        EXPECT_EQ(model.getNumFeatures(), 2);
+        for (const auto& row : X) EXPECT_EQ(model.predictProba(row), store.predictProba(row));
+    }
+}
+
+TEST_F(CodegenTest, GeneratedForestMatchesInterpreterInBatch) {
+    TreeSamplerParams params;
+    params.num_chains = 2;
+    params.num_iterations = 150;
+    params.burn_in = 50;
+    params.seed = 3;
+    TreeSampler sampler(params);
+    sampler.fit(X, y);
+    const SampledTreeStore& store = sampler.getSamples();
+
+    const CompiledModel model = buildModel(generateModelSource(store, 2), "forest");
+    std::vector<double> flat;
+    for (const auto& row : X) flat.insert(flat.end(), row.begin(), row.end());
+    std::vector<double> probs(X.size() * 3);
+    model.predictProbaBatch(flat.data(), X.size(), probs.data());
+    for (std::size_t i = 0; i < X.size(); ++i) {
+        const auto expected = store.predictProba(X[i]);
+        for (int k = 0; k < 3; ++k) EXPECT_EQ(probs[i * 3 + k], expected[k]);
+    }
+}
+
+TEST_F(CodegenTest, RejectsUnsupportedInputs) {
+    BayesTree unfitted;
+    EXPECT_THROW(generateModelSource(unfitted), std::logic_error);
+
+    SampledTreeStore compressed;
+    compressed.clear(2);
+    compressed.addTree({-1}, {0.0}, {0}, {-1}, {0.5, 0.5});
+    compressed.compressLeaves(LeafFormat::UInt16);
+    EXPECT_THROW(generateModelSource(compressed, 1), std::invalid_argument);
+
+    EXPECT_THROW(CompiledModel("/nonexistent/model.so"), std::runtime_error);
+}
+
+TEST_F(CodegenTest, RejectsCategoricalTrees) {
+    BayesTreeParams params;
+    params.categorical_features = {0};
+    for (auto& row : X) row[0] = static_cast<double>(static_cast<int>(row[0] * 20));
+    BayesTree tree(params);
+    tree.fit(X, y);
+    EXPECT_THROW(toSampledTreeStore(tree), std::invalid_argument);
+}
+
+TEST_F(CodegenTest, GeneratedTreeHandlesMissingOnlySplit) {
+    // x0 is constant apart from missing values, which carry the class
+    for (std::size_t i = 0; i < X.size(); ++i) {
+        const bool missing = i % 3 == 0;
+        X[i][0] = missing ? std::numeric_limits<double>::quiet_NaN() : 1.0;
+        y[i] = missing ? 1 : 0;
+    }
+    BayesTree tree;
+    tree.fit(X, y);
+    const SampledTreeStore store = toSampledTreeStore(tree);
+    const auto& thresholds = store.getThresholds();
+    ASSERT_NE(std::find(thresholds.begin(), thresholds.end(), std::numeric_limits<double>::infinity()),
+              thresholds.end());
+
+    CodegenParams nested;
+    nested.max_branchless_depth = 0;
+    CodegenParams branchless;
+    branchless.max_branchless_depth = 16;
+    int index = 0;
+    for (const auto& codegen : {nested, branchless}) {
+        const CompiledModel model =
+            buildModel(generateModelSource(tree, codegen), "missing" + std::to_string(index++));
+        for (const auto& row : X) EXPECT_EQ(model.predictProba(row), store.predictProba(row));
+        const std::vector<double> unseen = {1e300, 0.5};
+        EXPECT_EQ(model.predictProba(unseen), store.predictProba(unseen));
+    }
+}
+
+TEST_F(CodegenTest, ExportsLearnedMissingLeftDirections) {
+    // Every fifth row has x0 missing and class 0, so missing values learn to go left
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (std::size_t i = 0; i < X.size(); ++i) {
+        if (i % 5 == 0) {
+            X[i][0] = nan;
+            y[i] = 0;
+        }
+    }
+    BayesTreeParams params;
+    params.max_depth = 6;
+    BayesTree tree(params);
+    tree.fit(X, y);
+    const auto& nodes = tree.getNodes();
+    ASSERT_TRUE(std::any_of(nodes.begin(), nodes.end(), [](const Node& n) { return n.missing_left; }));
+
+    const SampledTreeStore store = toSampledTreeStore(tree);
+    for (const auto& row : X) EXPECT_EQ(store.predictProba(row), tree.predictProba(row));
+
+    std::stringstream file;
+    store.save(file);
+    const SampledTreeStore loaded = SampledTreeStore::load(file);
+    for (const auto& row : X) EXPECT_EQ(loaded.predictProba(row), store.predictProba(row));
+
+    CodegenParams nested;
+    nested.max_branchless_depth = 0;
+    CodegenParams branchless;
+    branchless.max_branchless_depth = 16;
+    int index = 0;
+    for (const auto& codegen : {nested, branchless}) {
+        const CompiledModel model =
+            buildModel(generateModelSource(tree, codegen), "missing_left" + std::to_string(index++));
+        for (const auto& row : X) EXPECT_EQ(model.predictProba(row), store.predictProba(row));
+    }
+}
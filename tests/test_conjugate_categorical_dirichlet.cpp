@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/lgamma_table.hpp"
 #include <cmath>
+#include <limits>
 #include <numeric>
 
 // Helper functions
@@ -53,6 +55,59 @@ protected:
     ConjugateCategoricalDirichlet cd{std::vector<double>{1.0, 1.0, 1.0}};
 };
 
+TEST_F(ConjugateCategoricalDirichletUpdateTest, UpdateFromObservationsAddsCounts) {
+    cd.updateFromObservations({5, 3, 2});
+    EXPECT_TRUE(vector_approx_equal(cd.getAlphas(), {6.0, 4.0, 3.0}));
+    EXPECT_TRUE(approx_equal(cd.getObservationDistribution().probs()[0], 6.0 / 13.0));
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, UpdateRejectsWrongLength) {
+    EXPECT_THROW(cd.updateFromObservations({1, 2}), std::invalid_argument);
+    EXPECT_THROW(cd.getLogLikelihoodFromObservations({1, 2}), std::invalid_argument);
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, UncheckedUpdateMatchesChecked) {
+    ConjugateCategoricalDirichlet unchecked{std::vector<double>{1.0, 1.0, 1.0}};
+    cd.updateFromObservations({5, 3, 2});
+    unchecked.updateFromObservationsUnchecked({5, 3, 2});
+    EXPECT_EQ(cd.getAlphas(), unchecked.getAlphas());
+    EXPECT_EQ(cd.getObservationDistribution().probs(),
+              unchecked.getObservationDistribution().probs());
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, UncheckedLogLikelihoodMatchesChecked) {
+    std::vector<int> counts = {4, 0, 7};
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservationsUnchecked(counts),
+                     cd.getLogLikelihoodFromObservations(counts));
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, WeightedMatchesIntegerCounts) {
+    ConjugateCategoricalDirichlet weighted{std::vector<double>{1.0, 1.0, 1.0}};
+    EXPECT_NEAR(weighted.getLogLikelihoodFromWeightedObservations({4.0, 0.0, 7.0}),
+                cd.getLogLikelihoodFromObservations(std::vector<int>{4, 0, 7}), 1e-12);
+    cd.updateFromObservations({5, 3, 2});
+    weighted.updateFromWeightedObservations({5.0, 3.0, 2.0});
+    EXPECT_EQ(cd.getAlphas(), weighted.getAlphas());
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, WeightedAcceptsFractionalCounts) {
+    cd.updateFromWeightedObservations({0.25, 1.5, 0.0});
+    EXPECT_TRUE(vector_approx_equal(cd.getAlphas(), {1.25, 2.5, 1.0}));
+    EXPECT_TRUE(approx_equal(cd.getObservationDistribution().probs()[1], 2.5 / 4.75));
+
+    // lgamma of real arguments, against the closed form
+    const std::vector<double> counts = {0.5, 2.25, 0.0};
+    double expected = std::lgamma(4.75) - std::lgamma(4.75 + 2.75);
+    expected += std::lgamma(1.75) - std::lgamma(1.25) + std::lgamma(4.75) - std::lgamma(2.5);
+    EXPECT_NEAR(cd.getLogLikelihoodFromWeightedObservations(counts), expected, 1e-12);
+}
+
+TEST_F(ConjugateCategoricalDirichletUpdateTest, WeightedRejectsBadCounts) {
+    EXPECT_THROW(cd.updateFromWeightedObservations({1.0, 2.0}), std::invalid_argument);
+    EXPECT_THROW(cd.updateFromWeightedObservations({1.0, -0.5, 2.0}), std::invalid_argument);
+    EXPECT_THROW(cd.getLogLikelihoodFromWeightedObservations({1.0, NAN, 2.0}), std::invalid_argument);
+}
+
 // TEST_F(ConjugateCategoricalDirichletUpdateTest, UpdateWithCounts) {
 //     std::vector<int> counts = {5, 3, 2};
 //     cd.update(counts);
@@ -84,6 +139,83 @@ protected:
 //     EXPECT_LT(log_prob, 0);  // log probability should be negative
 // }
 
+// Test suite for the table-driven marginal likelihood
+namespace {
+double referenceLogLikelihood(const std::vector<double>& alphas, const std::vector<int>& counts) {
+    double alpha_total = 0.0, count_total = 0.0, ll = 0.0;
+    for (size_t i = 0; i < alphas.size(); ++i) {
+        alpha_total += alphas[i];
+        count_total += counts[i];
+        ll += std::lgamma(counts[i] + alphas[i]) - std::lgamma(alphas[i]);
+    }
+    return ll + std::lgamma(alpha_total) - std::lgamma(count_total + alpha_total);
+}
+}
+
+class ConjugateCategoricalDirichletLgammaTableTest : public ::testing::Test {
+protected:
+    std::vector<int> counts = {0, 3, 17, 250, 1};
+};
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, JeffreysMatchesLibm) {
+    ConjugateCategoricalDirichlet cd(5);
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservations(counts),
+                     referenceLogLikelihood(cd.getAlphas(), counts));
+}
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, IntegerEqualAlphaMatchesLibm) {
+    ConjugateCategoricalDirichlet cd(5, 2.0);
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservations(counts),
+                     referenceLogLikelihood(cd.getAlphas(), counts));
+}
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, PosteriorAlphasStayOnTablePath) {
+    ConjugateCategoricalDirichlet cd(5);
+    cd.updateFromObservations({1, 2, 3, 4, 5});
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservations(counts),
+                     referenceLogLikelihood(cd.getAlphas(), counts));
+}
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, CountsBeyondTableFallBack) {
+    ConjugateCategoricalDirichlet cd(2);
+    const int big = static_cast<int>(HalfIntegerLgammaTable::instance().size());
+    std::vector<int> big_counts = {big, 3};
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservations(big_counts),
+                     referenceLogLikelihood(cd.getAlphas(), big_counts));
+}
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, NonLatticeAlphaUsesGenericPath) {
+    ConjugateCategoricalDirichlet cd(5, 0.7);
+    EXPECT_NEAR(cd.getLogLikelihoodFromObservations(counts),
+                referenceLogLikelihood(cd.getAlphas(), counts), 1e-9);
+}
+
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, LatticeFlagFollowsAlphaChanges) {
+    ConjugateCategoricalDirichlet cd(5);
+    EXPECT_TRUE(cd.getParameterDistribution().hasHalfIntegerAlphas());
+    
+    cd.getParameterDistribution().setAlpha({0.5, 0.7, 1.0, 1.5, 2.0});
+    EXPECT_FALSE(cd.getParameterDistribution().hasHalfIntegerAlphas());
+    EXPECT_NEAR(cd.getLogLikelihoodFromObservations(counts),
+                referenceLogLikelihood(cd.getAlphas(), counts), 1e-9);
+    
+    cd.getParameterDistribution().setAlphaUnchecked({0.5, 1.0, 1.0, 1.5, 2.0});
+    EXPECT_TRUE(cd.getParameterDistribution().hasHalfIntegerAlphas());
+    EXPECT_DOUBLE_EQ(cd.getLogLikelihoodFromObservations(counts),
+                     referenceLogLikelihood(cd.getAlphas(), counts));
+}
+
+TEST(HalfIntegerLgammaTableTest, DetectsLatticeValues) {
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(0.5), 1);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(3.0), 6);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(0.7), -1);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(0.0), -1);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(1e300), -1);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(std::numeric_limits<double>::infinity()), -1);
+    EXPECT_EQ(HalfIntegerLgammaTable::twiceIfLattice(std::numeric_limits<double>::quiet_NaN()), -1);
+    EXPECT_DOUBLE_EQ(HalfIntegerLgammaTable::instance()(1), std::lgamma(0.5));
+}
+
 // Test suite for sampling
 class ConjugateCategoricalDirichletSamplingTest : public ::testing::Test {
 protected:
@@ -101,4 +233,9 @@ protected:
 //         EXPECT_GE(val, 0.0);
 //         EXPECT_LE(val, 1.0);
 //     }
-// }
\ No newline at end of file
+// }
+TEST_F(ConjugateCategoricalDirichletLgammaTableTest, HugeAlphaUsesGenericPath) {
+    ConjugateCategoricalDirichlet cd(std::vector<double>{0.5, 1e300});
+    EXPECT_FALSE(cd.getParameterDistribution().hasHalfIntegerAlphas());
+    EXPECT_TRUE(std::isfinite(cd.getLogLikelihoodFromObservations({1, 2})));
+}
@@ -208,4 +208,10 @@ TEST_F(DirichletAlphaTest, SetAlphaRejectsWrongSize) {
 TEST_F(DirichletAlphaTest, SetAlphaRejectsNegativeValues) {
     std::vector<double> invalid = {1.0, -2.0, 3.0};
     EXPECT_THROW(d.setAlpha(invalid), std::invalid_argument);
+}
+
+TEST_F(DirichletAlphaTest, SetAlphaUncheckedWithValidValues) {
+    std::vector<double> new_alpha = {1.0, 2.0, 3.0};
+    d.setAlphaUnchecked(new_alpha);
+    EXPECT_TRUE(vector_approx_equal(d.getAlpha(), new_alpha));
 }
\ No newline at end of file
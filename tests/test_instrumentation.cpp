@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include "bayes_tree/instrumentation.hpp"
+#include "bayes_tree/bayes_tree.hpp"
+#include "bayes_tree/categorical_distribution.hpp"
+#include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include <vector>
+
+// Test suite for runtime counters
+class InstrumentationCounterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Instrumentation::resetCounters();
+        Instrumentation::enableCounters(true);
+    }
+    void TearDown() override {
+        Instrumentation::enableCounters(false);
+        Instrumentation::resetCounters();
+    }
+};
+
+TEST_F(InstrumentationCounterTest, CountsConstructions) {
+    BayesTree tree;
+    CategoricalDistribution dist({0.2, 0.8});
+
+    auto c = Instrumentation::counters();
+    EXPECT_EQ(c.tree_constructions, 1u);
+    EXPECT_EQ(c.categorical_constructions, 1u);
+}
+
+TEST_F(InstrumentationCounterTest, CountsConjugateUpdatesAndLikelihoods) {
+    ConjugateCategoricalDirichlet cd(3);
+    cd.updateFromObservations({1, 2, 3});
+    cd.updateFromObservationsUnchecked({1, 0, 0});
+    cd.getLogLikelihoodFromObservations({1, 1, 1});
+    cd.getLogLikelihoodFromObservationsUnchecked({1, 1, 1});
+
+    auto c = Instrumentation::counters();
+    EXPECT_EQ(c.conjugate_initialisations, 1u);
+    EXPECT_EQ(c.dirichlet_constructions, 1u);
+    EXPECT_EQ(c.categorical_constructions, 1u);
+    EXPECT_EQ(c.posterior_updates, 2u);
+    EXPECT_EQ(c.likelihood_evaluations, 2u);
+}
+
+TEST_F(InstrumentationCounterTest, DisabledCountersDoNotChange) {
+    Instrumentation::enableCounters(false);
+    ConjugateCategoricalDirichlet cd(3);
+    cd.updateFromObservations({1, 2, 3});
+
+    auto c = Instrumentation::counters();
+    EXPECT_EQ(c.conjugate_initialisations, 0u);
+    EXPECT_EQ(c.posterior_updates, 0u);
+}
+
+TEST_F(InstrumentationCounterTest, ResetClearsCounters) {
+    BayesTree tree;
+    Instrumentation::resetCounters();
+    EXPECT_EQ(Instrumentation::counters().tree_constructions, 0u);
+}
+
+// Test suite for trace hook
+namespace {
+std::vector<TraceEvent> recorded_events;
+void recordEvent(const TraceEvent& e) { recorded_events.push_back(e); }
+}
+
+TEST(InstrumentationTraceTest, HookReceivesEventsOnlyWhenCompiledIn) {
+    recorded_events.clear();
+    Instrumentation::setTraceHook(&recordEvent);
+    BayesTree tree;
+    Instrumentation::setTraceHook(nullptr);
+
+    if (Instrumentation::traceCompiledIn()) {
+        ASSERT_EQ(recorded_events.size(), 1u);
+        EXPECT_STREQ(recorded_events[0].component, "BayesTree");
+        EXPECT_STREQ(recorded_events[0].event, "construct");
+        EXPECT_EQ(recorded_events[0].object, &tree);
+    } else {
+        EXPECT_TRUE(recorded_events.empty());
+    }
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include "bayes_tree/codegen.hpp"
+#include "bayes_tree/prediction_server.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Class is 1 iff x0 > 0.5, or the reverse when `flipped`; x1 is noise
+SampledTreeStore makeModel(bool flipped) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    for (int i = 0; i < 400; ++i) {
+        double x0 = (i % 20) / 20.0;
+        double x1 = ((i * 37) % 101) / 101.0;
+        X.push_back({x0, x1});
+        y.push_back((x0 > 0.5) != flipped ? 1 : 0);
+    }
+    BayesTree tree;
+    tree.fit(X, y);
+    return toSampledTreeStore(tree);
+}
+
+std::vector<double> testRow(int i) {
+    return {(i % 17) / 17.0, (i % 5) / 5.0};
+}
+
+}  // namespace
+
+// Test suite for the prediction server
+class PredictionServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / ("bayes_tree_server_test_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(dir);
+        model_a = makeModel(false);
+        model_b = makeModel(true);
+        path_a = (dir / "a.bin").string();
+        path_b = (dir / "b.bin").string();
+        std::ofstream out_a(path_a, std::ios::binary);
+        model_a.save(out_a);
+        std::ofstream out_b(path_b, std::ios::binary);
+        model_b.save(out_b);
+        params.socket_path = (dir / "server.sock").string();
+    }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    std::filesystem::path dir;
+    SampledTreeStore model_a, model_b;
+    std::string path_a, path_b;
+    PredictionServerParams params;
+};
+
+TEST_F(PredictionServerTest, ConcurrentClientsGetStorePredictions) {
+    PredictionServer server(path_a, params);
+    server.start();
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> clients;
+    for (int c = 0; c < 4; ++c) {
+        clients.emplace_back([&, c] {
+            PredictionClient client(params.socket_path);
+            for (int i = 0; i < 50; ++i) {
+                const auto x = testRow(c * 50 + i);
+                if (client.predictProba(x) != model_a.predictProba(x)) ++mismatches;
+            }
+        });
+    }
+    for (auto& t : clients) t.join();
+    server.stop();
+
+    EXPECT_EQ(mismatches.load(), 0);
+    const auto stats = server.getStats();
+    EXPECT_EQ(stats.requests, 200u);
+    EXPECT_GE(stats.batches, 1u);
+    EXPECT_EQ(stats.rejected, 0u);
+}
+
+TEST_F(PredictionServerTest, PipelinedRequestsAreCoalescedIntoBatches) {
+    params.max_batch_size = 16;
+    params.max_wait_us = 50000;
+    PredictionServer server(path_a, params);
+    server.start();
+
+    PredictionClient client(params.socket_path);
+    for (std::uint32_t i = 0; i < 64; ++i) client.send(i, testRow(i));
+    std::vector<bool> seen(64, false);
+    for (int i = 0; i < 64; ++i) {
+        const auto response = client.receive();
+        ASSERT_LT(response.id, 64u);
+        seen[response.id] = true;
+        EXPECT_EQ(response.probs, model_a.predictProba(testRow(response.id)));
+    }
+    server.stop();
+
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), true), 64);
+    const auto stats = server.getStats();
+    EXPECT_EQ(stats.requests, 64u);
+    EXPECT_LT(stats.batches, 64u);
+}
+
+TEST_F(PredictionServerTest, RejectsRowsWithTooFewFeatures) {
+    PredictionServer server(path_a, params);
+    server.start();
+
+    PredictionClient client(params.socket_path);
+    EXPECT_THROW(client.predictProba({}), std::runtime_error);
+    EXPECT_EQ(client.predictProba(testRow(3)), model_a.predictProba(testRow(3)));
+    server.stop();
+    EXPECT_EQ(server.getStats().rejected, 1u);
+}
+
+TEST_F(PredictionServerTest, HotReloadDoesNotDisturbInFlightRequests) {
+    PredictionServer server(path_a, params);
+    server.start();
+    EXPECT_EQ(server.getModelVersion(), 1u);
+
+    // Odd versions serve model A, even versions model B
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+    std::atomic<int> answered{0};
+    std::vector<std::thread> clients;
+    for (int c = 0; c < 3; ++c) {
+        clients.emplace_back([&, c] {
+            try {
+                PredictionClient client(params.socket_path);
+                for (std::uint32_t i = 0; !done; ++i) {
+                    const auto x = testRow(static_cast<int>(i) + c);
+                    client.send(i, x);
+                    const auto response = client.receive();
+                    const auto& model = response.model_version % 2 ? model_a : model_b;
+                    if (response.id != i || response.probs != model.predictProba(x)) ++errors;
+                    ++answered;
+                }
+            } catch (const std::exception&) {
+                ++errors;
+            }
+        });
+    }
+
+    for (int r = 0; r < 6; ++r) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        server.reloadModel(r % 2 ? path_a : path_b);
+    }
+    EXPECT_THROW(server.reloadModel((dir / "missing.bin").string()), std::runtime_error);
+    done = true;
+    for (auto& t : clients) t.join();
+
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_GT(answered.load(), 0);
+    EXPECT_EQ(server.getModelVersion(), 7u);
+    EXPECT_EQ(server.getStats().reloads, 6u);
+
+    PredictionClient client(params.socket_path);
+    EXPECT_EQ(client.predictProba(testRow(5)), model_a.predictProba(testRow(5)));
+    server.stop();
+}
+
+TEST_F(PredictionServerTest, ClientThatNeverReadsIsClosedWithoutStallingOthers) {
+    params.max_outbound_bytes = 64 * 1024;
+    PredictionServer server(path_a, params);
+    server.start();
+
+    // Pipelines requests without reading: its socket buffer fills, then its
+    // outbox, and the server closes the connection
+    std::thread flooder([&] {
+        PredictionClient client(params.socket_path);
+        try {
+            for (std::uint32_t i = 0; i < 10000000; ++i) client.send(i, testRow(static_cast<int>(i)));
+        } catch (const std::runtime_error&) {
+        }
+    });
+
+    PredictionClient client(params.socket_path);
+    for (int i = 0; i < 200; ++i) EXPECT_EQ(client.predictProba(testRow(i)), model_a.predictProba(testRow(i)));
+    flooder.join();
+    EXPECT_EQ(client.predictProba(testRow(7)), model_a.predictProba(testRow(7)));
+    server.stop();
+    EXPECT_EQ(server.getStats().slow_clients_closed, 1u);
+}
+
+TEST_F(PredictionServerTest, StopDoesNotWaitForClientThatNeverReads) {
+    PredictionServer server(path_a, params);
+    server.start();
+
+    // More responses than the socket buffers hold, but under the outbox bound
+    PredictionClient client(params.socket_path);
+    for (std::uint32_t i = 0; i < 20000; ++i) client.send(i, testRow(static_cast<int>(i)));
+    while (server.getStats().requests < 20000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const auto start = std::chrono::steady_clock::now();
+    server.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    EXPECT_EQ(server.getStats().slow_clients_closed, 0u);
+}
+
+TEST_F(PredictionServerTest, EmptyModelIsRejectedAndOldModelKeepsServing) {
+    const std::string empty_path = (dir / "empty.bin").string();
+    SampledTreeStore empty;
+    empty.clear(2);
+    std::ofstream out(empty_path, std::ios::binary);
+    empty.save(out);
+    out.close();
+
+    EXPECT_THROW(PredictionServer(empty_path, params), std::runtime_error);
+    PredictionServer server(path_a, params);
+    server.start();
+    EXPECT_THROW(server.reloadModel(empty_path), std::runtime_error);
+    EXPECT_EQ(server.getModelVersion(), 1u);
+
+    PredictionClient client(params.socket_path);
+    EXPECT_EQ(client.predictProba(testRow(2)), model_a.predictProba(testRow(2)));
+    server.stop();
+}
+
+TEST_F(PredictionServerTest, RejectsBadParams) {
+    params.max_batch_size = 0;
+    EXPECT_THROW(PredictionServer(path_a, params), std::invalid_argument);
+    params.max_batch_size = 8;
+    params.max_outbound_bytes = 0;
+    EXPECT_THROW(PredictionServer(path_a, params), std::invalid_argument);
+    params.max_outbound_bytes = 1 << 20;
+    params.socket_path = std::string(200, 'x');
+    EXPECT_THROW(PredictionServer(path_a, params), std::invalid_argument);
+}
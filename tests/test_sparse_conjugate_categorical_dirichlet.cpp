@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "bayes_tree/sparse_conjugate_categorical_dirichlet.hpp"
+#include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include <cmath>
+
+// Test suite for sparse count helpers
+TEST(SparseCountsTest, DenseRoundTrip) {
+    std::vector<int> dense = {0, 3, 0, 0, 5};
+    auto sparse = toSparseCounts(dense);
+    ASSERT_EQ(sparse.size(), 2u);
+    EXPECT_EQ(sparse[0].index, 1);
+    EXPECT_EQ(sparse[1].count, 5);
+    EXPECT_EQ(toDenseCounts(sparse, 5), dense);
+}
+
+TEST(SparseCountsTest, RejectsInvalidCounts) {
+    EXPECT_THROW(validateSparseCounts({{3, 1}, {1, 1}}, 5), std::invalid_argument);
+    EXPECT_THROW(validateSparseCounts({{5, 1}}, 5), std::invalid_argument);
+    EXPECT_THROW(validateSparseCounts({{1, -1}}, 5), std::invalid_argument);
+}
+
+// Test suite for sparse likelihoods on the dense class
+class ConjugateSparseOverloadTest : public ::testing::Test {
+protected:
+    ConjugateCategoricalDirichlet cd{std::vector<double>{0.7, 1.3, 2.0, 0.4, 1.1}};
+    std::vector<int> dense = {0, 4, 0, 2, 0};
+};
+
+TEST_F(ConjugateSparseOverloadTest, LogLikelihoodMatchesDense) {
+    EXPECT_NEAR(cd.getLogLikelihoodFromObservations(toSparseCounts(dense)),
+                cd.getLogLikelihoodFromObservations(dense), 1e-12);
+}
+
+TEST_F(ConjugateSparseOverloadTest, JeffreysLogLikelihoodMatchesDense) {
+    ConjugateCategoricalDirichlet jeffreys(5);
+    jeffreys.updateFromObservations({1, 0, 2, 0, 0});
+    EXPECT_DOUBLE_EQ(jeffreys.getLogLikelihoodFromObservations(toSparseCounts(dense)),
+                     jeffreys.getLogLikelihoodFromObservations(dense));
+}
+
+TEST_F(ConjugateSparseOverloadTest, UpdateMatchesDense) {
+    ConjugateCategoricalDirichlet other = cd;
+    cd.updateFromObservations(dense);
+    other.updateFromObservations(toSparseCounts(dense));
+    EXPECT_EQ(cd.getAlphas(), other.getAlphas());
+    EXPECT_DOUBLE_EQ(cd.getParameterDistribution().getAlphaTotal(),
+                     other.getParameterDistribution().getAlphaTotal());
+}
+
+// Test suite for the sparse conjugate pair
+class SparseConjugateCategoricalDirichletTest : public ::testing::Test {
+protected:
+    static constexpr int K = 100000;
+    SparseCounts first = {{7, 3}, {500, 1}, {99999, 2}};
+    SparseCounts second = {{7, 1}, {42, 5}, {99999, 4}};
+};
+
+TEST_F(SparseConjugateCategoricalDirichletTest, MatchesDenseJeffreys) {
+    SparseConjugateCategoricalDirichlet sparse(K);
+    ConjugateCategoricalDirichlet dense(K);
+
+    sparse.updateFromObservations(first);
+    dense.updateFromObservations(toDenseCounts(first, K));
+
+    EXPECT_NEAR(sparse.getLogLikelihoodFromObservations(second),
+                dense.getLogLikelihoodFromObservations(toDenseCounts(second, K)), 1e-8);
+    EXPECT_EQ(sparse.getNumObservedCategories(), 3);
+    EXPECT_DOUBLE_EQ(sparse.getAlpha(7), 3.5);
+    EXPECT_DOUBLE_EQ(sparse.getAlpha(8), 0.5);
+}
+
+TEST_F(SparseConjugateCategoricalDirichletTest, MatchesDenseNonLatticeAlpha) {
+    SparseConjugateCategoricalDirichlet sparse(1000, 0.3);
+    ConjugateCategoricalDirichlet dense(1000, 0.3);
+    SparseCounts counts = {{1, 3}, {999, 1}};
+
+    sparse.updateFromObservations(counts);
+    dense.updateFromObservations(toDenseCounts(counts, 1000));
+
+    SparseCounts query = {{1, 2}, {2, 7}};
+    EXPECT_NEAR(sparse.getLogLikelihoodFromObservations(query),
+                dense.getLogLikelihoodFromObservations(toDenseCounts(query, 1000)), 1e-9);
+    EXPECT_NEAR(sparse.getMean(1), dense.getObservationDistribution().probs()[1], 1e-12);
+}
+
+TEST_F(SparseConjugateCategoricalDirichletTest, UpdatesMergeDeltas) {
+    SparseConjugateCategoricalDirichlet sparse(K);
+    sparse.updateFromObservations(first);
+    sparse.updateFromObservations(second);
+
+    const auto& observed = sparse.getObservedCounts();
+    ASSERT_EQ(observed.size(), 4u);
+    EXPECT_EQ(observed[0].index, 7);
+    EXPECT_EQ(observed[0].count, 4);
+    EXPECT_EQ(observed[1].index, 42);
+    EXPECT_EQ(observed[3].count, 6);
+    EXPECT_DOUBLE_EQ(sparse.getAlphaTotal(), 0.5 * K + 16);
+}
+
+TEST_F(SparseConjugateCategoricalDirichletTest, RejectsBadInput) {
+    EXPECT_THROW(SparseConjugateCategoricalDirichlet(0), std::invalid_argument);
+    SparseConjugateCategoricalDirichlet sparse(10);
+    EXPECT_THROW(sparse.updateFromObservations({{10, 1}}), std::invalid_argument);
+    EXPECT_THROW(sparse.getAlpha(10), std::out_of_range);
+}
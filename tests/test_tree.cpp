@@ -1,8 +1,524 @@
 #include <gtest/gtest.h>
 #include "bayes_tree/bayes_tree.hpp"
+#include "bayes_tree/categorical_distribution.hpp"
+#include "bayes_tree/conjugate_categorical_dirichlet.hpp"
+#include <cmath>
+#include <limits>
 
 TEST(BayesTreeTest, BasicTreePredictionTest) {
     BayesTree tree;
     double result = tree.predict(2.0);
     EXPECT_EQ(result, 5.0);
-}
\ No newline at end of file
+}
+
+// Helpers for training tests
+namespace {
+
+// Two features; class is 1 iff x0 > 0.5, x1 is noise
+void makeThresholdData(int n, BayesTree::FeatureMatrix& X, std::vector<int>& y) {
+    X.clear();
+    y.clear();
+    for (int i = 0; i < n; ++i) {
+        double x0 = (i % 20) / 20.0;
+        double x1 = ((i * 37) % 101) / 101.0;
+        X.push_back({x0, x1});
+        y.push_back(x0 > 0.5 ? 1 : 0);
+    }
+}
+
+}  // namespace
+
+// Test suite for training
+class BayesTreeFitTest : public ::testing::Test {
+protected:
+    void SetUp() override { makeThresholdData(1000, X, y); }
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+};
+
+TEST_F(BayesTreeFitTest, LearnsSingleThreshold) {
+    BayesTree tree;
+    tree.fit(X, y);
+
+    EXPECT_TRUE(tree.isFitted());
+    EXPECT_EQ(tree.getNumClasses(), 2);
+    const Node& root = tree.getNodes()[0];
+    EXPECT_FALSE(root.isLeaf());
+    EXPECT_EQ(root.feature, 0);
+    EXPECT_NEAR(root.threshold, 0.525, 1e-12);  // Midpoint of 0.50 and 0.55
+
+    for (size_t i = 0; i < X.size(); ++i) {
+        EXPECT_EQ(tree.predictClass(X[i]), y[i]);
+    }
+}
+
+TEST_F(BayesTreeFitTest, PredictProbaIsPosteriorMean) {
+    BayesTree tree;
+    tree.fit(X, y);
+
+    auto probs = tree.predictProba(std::vector<double>{0.9, 0.1});
+    ASSERT_EQ(probs.size(), 2u);
+    EXPECT_NEAR(probs[0] + probs[1], 1.0, 1e-12);
+    // Pure leaf of class 1 rows under a Jeffreys prior: (n + 0.5) / (n + 1)
+    const Node& root = tree.getNodes()[0];
+    const Node& leaf = tree.getNodes()[root.right];
+    ASSERT_TRUE(leaf.isLeaf());
+    EXPECT_EQ(leaf.counts[0], 0);
+    EXPECT_NEAR(probs[1], (leaf.counts[1] + 0.5) / (leaf.counts[1] + 1.0), 1e-12);
+}
+
+TEST_F(BayesTreeFitTest, RespectsMaxDepth) {
+    BayesTreeParams params;
+    params.max_depth = 0;
+    BayesTree tree(params);
+    tree.fit(X, y);
+    EXPECT_EQ(tree.getNumNodes(), 1u);
+}
+
+TEST_F(BayesTreeFitTest, RejectsMismatchedRows) {
+    BayesTree tree;
+    y.pop_back();
+    EXPECT_THROW(tree.fit(X, y), std::invalid_argument);
+}
+
+TEST_F(BayesTreeFitTest, MultithreadedFitMatchesSingleThreaded) {
+    // Noisy labels so the tree grows several levels
+    for (size_t i = 0; i < y.size(); i += 7) y[i] = 1 - y[i];
+
+    BayesTree single;
+    single.fit(X, y);
+
+    BayesTreeParams params;
+    params.num_threads = 4;
+    BayesTree multi(params);
+    multi.fit(X, y);
+
+    ASSERT_EQ(single.getNumNodes(), multi.getNumNodes());
+    for (size_t i = 0; i < single.getNodes().size(); ++i) {
+        EXPECT_EQ(single.getNodes()[i].feature, multi.getNodes()[i].feature);
+        EXPECT_EQ(single.getNodes()[i].threshold, multi.getNodes()[i].threshold);
+        EXPECT_EQ(single.getNodes()[i].counts, multi.getNodes()[i].counts);
+    }
+}
+
+TEST_F(BayesTreeFitTest, ChildrenPartitionParentRows) {
+    for (size_t i = 0; i < y.size(); i += 7) y[i] = 1 - y[i];
+    BayesTreeParams params;
+    params.num_threads = 3;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    int total_leaf_rows = 0;
+    for (const Node& node : tree.getNodes()) {
+        if (node.isLeaf()) {
+            total_leaf_rows += node.counts[0] + node.counts[1];
+            continue;
+        }
+        const Node& left = tree.getNodes()[node.left];
+        const Node& right = tree.getNodes()[node.right];
+        for (int k = 0; k < 2; ++k)
+            EXPECT_EQ(left.counts[k] + right.counts[k], node.counts[k]);
+    }
+    EXPECT_EQ(total_leaf_rows, static_cast<int>(X.size()));
+
+    // Every training row lands in a leaf whose counts include its label
+    for (size_t i = 0; i < X.size(); ++i) {
+        int index = 0;
+        while (!tree.getNodes()[index].isLeaf()) {
+            const Node& node = tree.getNodes()[index];
+            index = X[i][node.feature] <= node.threshold ? node.left : node.right;
+        }
+        EXPECT_GT(tree.getNodes()[index].counts[y[i]], 0);
+    }
+}
+
+// Test suite for the training report
+TEST_F(BayesTreeFitTest, TrainingReportHasLevelsAndThreads) {
+    BayesTreeParams params;
+    params.num_threads = 2;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const auto& report = tree.getTrainingReport();
+    EXPECT_EQ(report.threads.size(), 2u);
+    ASSERT_EQ(report.levels.size(), static_cast<size_t>(tree.getDepth() + 1));
+    EXPECT_EQ(report.levels[0].num_nodes, 1);
+    EXPECT_EQ(report.levels[0].num_rows, X.size());
+    EXPECT_GE(report.total_wall_seconds, 0.0);
+
+    if (report.profiling_enabled) {
+        EXPECT_GT(report.candidate_splits_scored, 0u);
+        // Two children per candidate plus one parent term per scanned node
+        EXPECT_GT(report.likelihood_evaluations, 2 * report.candidate_splits_scored);
+        EXPECT_GT(report.phases[static_cast<size_t>(TrainingPhase::SplitScoring)].wall_seconds, 0.0);
+        EXPECT_GT(report.levels[0].bytes_touched, 0u);
+    } else {
+        EXPECT_EQ(report.candidate_splits_scored, 0u);
+    }
+}
+
+// Test suite for hierarchical shrinkage priors
+namespace {
+
+// Threshold data with every seventh label flipped, so children are impure
+void makeNoisyThresholdData(int n, BayesTree::FeatureMatrix& X, std::vector<int>& y) {
+    makeThresholdData(n, X, y);
+    for (int i = 0; i < n; i += 7) y[i] = 1 - y[i];
+}
+
+}  // namespace
+
+TEST(BayesTreeHierarchicalPriorTest, ChildPriorMatchesManualJeffreysFromParent) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeNoisyThresholdData(1000, X, y);
+
+    BayesTreeParams params;
+    params.hierarchical_prior = true;
+    params.max_depth = 3;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const auto& nodes = tree.getNodes();
+    ASSERT_FALSE(nodes[0].isLeaf());
+    int checked = 0;
+    for (const Node& parent : nodes) {
+        if (parent.isLeaf()) continue;
+        double total = 0.0;
+        for (double a : parent.posterior_alphas) total += a;
+        std::vector<double> mean;
+        for (double a : parent.posterior_alphas) mean.push_back(a / total);
+
+        for (int child : {parent.left, parent.right}) {
+            ConjugateCategoricalDirichlet expected;
+            expected.initialiseJeffreysFromObservationDistribution(CategoricalDistribution(mean));
+            expected.updateFromObservations(nodes[child].counts);
+            const auto alphas = expected.getAlphas();
+            ASSERT_EQ(alphas.size(), nodes[child].posterior_alphas.size());
+            for (size_t k = 0; k < alphas.size(); ++k)
+                EXPECT_NEAR(nodes[child].posterior_alphas[k], alphas[k], 1e-9);
+            ++checked;
+        }
+    }
+    EXPECT_GE(checked, 2);
+}
+
+TEST(BayesTreeHierarchicalPriorTest, ConcentrationSetsChildPriorMass) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeNoisyThresholdData(1000, X, y);
+
+    BayesTreeParams params;
+    params.hierarchical_prior = true;
+    params.prior_concentration = 10.0;
+    params.max_depth = 2;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const auto& nodes = tree.getNodes();
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        double alpha_total = 0.0;
+        int n = 0;
+        for (size_t k = 0; k < nodes[i].counts.size(); ++k) {
+            alpha_total += nodes[i].posterior_alphas[k];
+            n += nodes[i].counts[k];
+        }
+        EXPECT_NEAR(alpha_total, 10.0 + n, 1e-9);
+    }
+    // The root keeps the flat Jeffreys prior
+    EXPECT_NEAR(nodes[0].posterior_alphas[0] + nodes[0].posterior_alphas[1], 1.0 + X.size(), 1e-9);
+}
+
+TEST_F(BayesTreeFitTest, HierarchicalPriorLearnsSameThreshold) {
+    BayesTreeParams params;
+    params.hierarchical_prior = true;
+    params.num_threads = 2;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const Node& root = tree.getNodes()[0];
+    EXPECT_EQ(root.feature, 0);
+    EXPECT_NEAR(root.threshold, 0.525, 1e-12);
+    for (size_t i = 0; i < X.size(); ++i) {
+        EXPECT_EQ(tree.predictClass(X[i]), y[i]);
+    }
+}
+
+// Test suite for categorical features and missing values
+TEST(BayesTreeCategoricalTest, SplitsCategorySetInOneNode) {
+    // Class 1 iff the code is in {1, 4, 7}: no single threshold separates it
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    for (int i = 0; i < 500; ++i) {
+        const int code = i % 10;
+        X.push_back({static_cast<double>(code), (i % 7) / 7.0});
+        y.push_back(code == 1 || code == 4 || code == 7);
+    }
+
+    BayesTreeParams params;
+    params.max_depth = 1;
+    params.categorical_features = {0};
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const Node& root = tree.getNodes()[0];
+    ASSERT_FALSE(root.isLeaf());
+    EXPECT_EQ(root.feature, 0);
+    EXPECT_TRUE(root.categorical);
+    const bool ones_left = root.left_categories.test(1);
+    for (int code = 0; code < 10; ++code) {
+        const bool positive = code == 1 || code == 4 || code == 7;
+        EXPECT_EQ(root.left_categories.test(code), positive == ones_left);
+    }
+    for (size_t i = 0; i < X.size(); ++i) EXPECT_EQ(tree.predictClass(X[i]), y[i]);
+    // Codes never seen in training go right
+    EXPECT_EQ(tree.predictProba(std::vector<double>{200.0, 0.5}),
+              tree.predictProba(std::vector<double>{ones_left ? 0.0 : 1.0, 0.5}));
+}
+
+TEST(BayesTreeCategoricalTest, RejectsNonIntegerCodes) {
+    BayesTreeParams params;
+    params.categorical_features = {0};
+    BayesTree tree(params);
+    EXPECT_THROW(tree.fit({{0.5}, {1.0}}, {0, 1}), std::invalid_argument);
+    EXPECT_THROW(tree.fit({{255.0}, {1.0}}, {0, 1}), std::invalid_argument);
+
+    params.categorical_features = {3};
+    BayesTree out_of_range(params);
+    EXPECT_THROW(out_of_range.fit({{0.0}, {1.0}}, {0, 1}), std::invalid_argument);
+}
+
+TEST(BayesTreeMissingValueTest, LearnsDefaultDirectionFromMissingRows) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (int missing_class : {0, 1}) {
+        // Class is x0 > 0.5; every fifth row has x0 missing and label missing_class
+        BayesTree::FeatureMatrix X;
+        std::vector<int> y;
+        for (int i = 0; i < 500; ++i) {
+            const double x0 = (i % 20) / 20.0;
+            const bool missing = i % 5 == 0;
+            X.push_back({missing ? nan : x0});
+            y.push_back(missing ? missing_class : x0 > 0.5);
+        }
+
+        BayesTreeParams params;
+        params.max_depth = 1;
+        BayesTree tree(params);
+        tree.fit(X, y);
+
+        const Node& root = tree.getNodes()[0];
+        ASSERT_FALSE(root.isLeaf());
+        EXPECT_FALSE(root.categorical);
+        EXPECT_EQ(root.missing_left, missing_class == 0);
+        EXPECT_EQ(tree.predictClass(std::vector<double>{nan}), missing_class);
+        for (size_t i = 0; i < X.size(); ++i) EXPECT_EQ(tree.predictClass(X[i]), y[i]);
+        // Missing rows are counted in the child they were sent to
+        const Node& child = tree.getNodes()[root.missing_left ? root.left : root.right];
+        EXPECT_EQ(child.counts[0] + child.counts[1], 300);
+    }
+}
+
+TEST(BayesTreeMissingValueTest, CanSplitOnMissingnessAlone) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    for (int i = 0; i < 200; ++i) {
+        const bool missing = i % 2 == 0;
+        X.push_back({missing ? nan : (i % 10) / 10.0});
+        y.push_back(missing);
+    }
+
+    BayesTreeParams params;
+    params.max_depth = 1;
+    BayesTree tree(params);
+    tree.fit(X, y);
+
+    const Node& root = tree.getNodes()[0];
+    ASSERT_FALSE(root.isLeaf());
+    EXPECT_FALSE(root.missing_left);
+    EXPECT_TRUE(std::isinf(root.threshold));
+    for (size_t i = 0; i < X.size(); ++i) EXPECT_EQ(tree.predictClass(X[i]), y[i]);
+}
+
+// Test suite for weighted training
+TEST_F(BayesTreeFitTest, UnitWeightsMatchUnweightedFit) {
+    BayesTree unweighted;
+    unweighted.fit(X, y);
+    BayesTree weighted;
+    weighted.fit(X, y, std::vector<double>(y.size(), 1.0));
+
+    ASSERT_EQ(unweighted.getNumNodes(), weighted.getNumNodes());
+    for (size_t i = 0; i < unweighted.getNumNodes(); ++i) {
+        const Node& a = unweighted.getNodes()[i];
+        const Node& b = weighted.getNodes()[i];
+        EXPECT_EQ(a.feature, b.feature);
+        EXPECT_EQ(a.threshold, b.threshold);
+        EXPECT_EQ(a.counts, b.counts);
+        for (size_t k = 0; k < a.posterior_alphas.size(); ++k)
+            EXPECT_DOUBLE_EQ(a.posterior_alphas[k], b.posterior_alphas[k]);
+    }
+}
+
+TEST(BayesTreeWeightedTest, IntegerWeightsMatchRepeatedRows) {
+    // Noisy labels so that the tree has several levels
+    BayesTree::FeatureMatrix X, X_repeated;
+    std::vector<int> y, y_repeated;
+    std::vector<double> weights;
+    for (int i = 0; i < 300; ++i) {
+        const double x0 = (i % 30) / 30.0;
+        const double x1 = ((i * 37) % 101) / 101.0;
+        const int label = (x0 > 0.4) != (i % 7 == 0);
+        const int weight = 1 + (i * 13) % 3;
+        X.push_back({x0, x1});
+        y.push_back(label);
+        weights.push_back(weight);
+        for (int w = 0; w < weight; ++w) {
+            X_repeated.push_back({x0, x1});
+            y_repeated.push_back(label);
+        }
+    }
+
+    BayesTreeParams params;
+    params.max_bins = 256;  // Same bin edges for both data sets
+    BayesTree weighted(params);
+    weighted.fit(X, y, weights);
+    BayesTree repeated(params);
+    repeated.fit(X_repeated, y_repeated);
+
+    ASSERT_EQ(weighted.getNumNodes(), repeated.getNumNodes());
+    ASSERT_GT(weighted.getNumNodes(), 3u);
+    for (size_t i = 0; i < weighted.getNumNodes(); ++i) {
+        const Node& a = weighted.getNodes()[i];
+        const Node& b = repeated.getNodes()[i];
+        EXPECT_EQ(a.feature, b.feature);
+        EXPECT_EQ(a.threshold, b.threshold);
+        for (size_t k = 0; k < a.posterior_alphas.size(); ++k)
+            EXPECT_NEAR(a.posterior_alphas[k], b.posterior_alphas[k], 1e-9);
+    }
+}
+
+TEST(BayesTreeWeightedTest, FractionalWeightsShiftPosterior) {
+    // One feature that does not separate the classes: the root stays a leaf
+    // whose posterior adds the summed weights of each class
+    BayesTree::FeatureMatrix X = {{0.0}, {0.0}, {0.0}, {0.0}};
+    std::vector<int> y = {0, 1, 1, 0};
+    std::vector<double> weights = {0.25, 1.5, 0.5, 0.0};
+
+    BayesTree tree;
+    tree.fit(X, y, weights);
+    ASSERT_EQ(tree.getNumNodes(), 1u);
+    const Node& root = tree.getNodes()[0];
+    EXPECT_EQ(root.counts, (std::vector<int>{2, 2}));
+    EXPECT_DOUBLE_EQ(root.posterior_alphas[0], 0.75);
+    EXPECT_DOUBLE_EQ(root.posterior_alphas[1], 2.5);
+}
+
+TEST_F(BayesTreeFitTest, RejectsBadWeights) {
+    BayesTree tree;
+    EXPECT_THROW(tree.fit(X, y, std::vector<double>(y.size() - 1, 1.0)), std::invalid_argument);
+    std::vector<double> weights(y.size(), 1.0);
+    weights[3] = -1.0;
+    EXPECT_THROW(tree.fit(X, y, weights), std::invalid_argument);
+    weights[3] = std::numeric_limits<double>::infinity();
+    EXPECT_THROW(tree.fit(X, y, weights), std::invalid_argument);
+}
+
+// Test suite for upper-bound pruning of the split search
+namespace {
+
+void expectSameTree(const BayesTree& a, const BayesTree& b) {
+    ASSERT_EQ(a.getNumNodes(), b.getNumNodes());
+    for (size_t i = 0; i < a.getNumNodes(); ++i) {
+        const Node& x = a.getNodes()[i];
+        const Node& y = b.getNodes()[i];
+        EXPECT_EQ(x.feature, y.feature);
+        EXPECT_EQ(x.threshold, y.threshold);
+        EXPECT_EQ(x.categorical, y.categorical);
+        EXPECT_EQ(x.missing_left, y.missing_left);
+        EXPECT_EQ(x.left_categories, y.left_categories);
+        EXPECT_EQ(x.counts, y.counts);
+        EXPECT_EQ(x.posterior_alphas, y.posterior_alphas);
+    }
+}
+
+// Three classes driven by x0 and a categorical x1, plus noise features and
+// missing values in x2
+void makeMixedData(int n, BayesTree::FeatureMatrix& X, std::vector<int>& y) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    X.clear();
+    y.clear();
+    for (int i = 0; i < n; ++i) {
+        const double x0 = (i % 50) / 50.0;
+        const int x1 = (i * 7) % 12;
+        const double x2 = i % 9 == 0 ? nan : ((i * 37) % 101) / 101.0;
+        const double x3 = ((i * 53) % 97) / 97.0;
+        int label = x0 < 0.3 ? 0 : (x1 % 3 == 0 ? 1 : 2);
+        if (i % 11 == 0) label = (label + 1) % 3;
+        X.push_back({x0, static_cast<double>(x1), x2, x3});
+        y.push_back(label);
+    }
+}
+
+}  // namespace
+
+TEST_F(BayesTreeFitTest, PrunedSearchMatchesExhaustiveSearch) {
+    BayesTreeParams params;
+    params.prune_splits = false;
+    BayesTree exhaustive(params);
+    exhaustive.fit(X, y);
+    params.prune_splits = true;
+    BayesTree pruned(params);
+    pruned.fit(X, y);
+    expectSameTree(exhaustive, pruned);
+
+    // Every candidate of the full scan is either scored or pruned
+    const auto& full = exhaustive.getTrainingReport();
+    const auto& report = pruned.getTrainingReport();
+    if (report.profiling_enabled) {
+        EXPECT_EQ(full.candidate_splits_pruned, 0u);
+        EXPECT_EQ(full.split_bounds_evaluated, 0u);
+        EXPECT_EQ(report.candidate_splits_scored + report.candidate_splits_pruned,
+                  full.candidate_splits_scored);
+        // x0 separates the classes, so most cuts of the noise feature x1 go
+        EXPECT_GT(report.candidate_splits_pruned, 0u);
+        EXPECT_GT(report.split_bounds_evaluated, 0u);
+        EXPECT_LT(report.candidate_splits_scored, full.candidate_splits_scored);
+    }
+}
+
+TEST(BayesTreePruningTest, MatchesExhaustiveSearchAcrossOptions) {
+    BayesTree::FeatureMatrix X;
+    std::vector<int> y;
+    makeMixedData(3000, X, y);
+    std::vector<double> weights(y.size());
+    for (size_t i = 0; i < y.size(); ++i) weights[i] = 0.25 + (i * 13 % 7) / 3.0;
+
+    for (int variant = 0; variant < 4; ++variant) {
+        BayesTreeParams params;
+        params.categorical_features = {1};
+        params.hierarchical_prior = variant == 1;
+        params.prior_alpha = variant == 2 ? 0.3 : 0.5;  // Off the lgamma table lattice
+        params.min_samples_leaf = variant == 2 ? 20 : 1;
+        params.min_gain = variant == 3 ? 2.0 : 0.0;
+
+        params.prune_splits = false;
+        BayesTree exhaustive(params), exhaustive_weighted(params);
+        exhaustive.fit(X, y);
+        exhaustive_weighted.fit(X, y, weights);
+        params.prune_splits = true;
+        BayesTree pruned(params), pruned_weighted(params);
+        pruned.fit(X, y);
+        pruned_weighted.fit(X, y, weights);
+
+        SCOPED_TRACE(variant);
+        expectSameTree(exhaustive, pruned);
+        expectSameTree(exhaustive_weighted, pruned_weighted);
+        EXPECT_GE(pruned.getNumNodes(), 5u);
+
+        const auto& report = pruned.getTrainingReport();
+        if (report.profiling_enabled) {
+            EXPECT_EQ(report.candidate_splits_scored + report.candidate_splits_pruned,
+                      exhaustive.getTrainingReport().candidate_splits_scored);
+        }
+    }
+}
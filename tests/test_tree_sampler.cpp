@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+#include "bayes_tree/tree_sampler.hpp"
+#include <cmath>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+// Class is 1 iff x0 > 0.5 (with 5% label noise), x1 is pure noise
+void makeData(int n, TreeSampler::FeatureMatrix& X, std::vector<int>& y) {
+    X.clear();
+    y.clear();
+    for (int i = 0; i < n; ++i) {
+        double x0 = (i % 20) / 20.0;
+        double x1 = ((i * 37) % 101) / 101.0;
+        X.push_back({x0, x1});
+        int label = x0 > 0.5 ? 1 : 0;
+        if (i % 20 == 3) label = 1 - label;
+        y.push_back(label);
+    }
+}
+
+TreeSamplerParams smallParams() {
+    TreeSamplerParams params;
+    params.num_chains = 2;
+    params.num_iterations = 300;
+    params.burn_in = 100;
+    params.seed = 42;
+    return params;
+}
+
+}  // namespace
+
+// Test suite for the counter-based RNG
+TEST(CounterRngTest, StreamsAreReproducibleAndDistinct) {
+    CounterRng a(7, 0), b(7, 0), c(7, 1);
+    for (int i = 0; i < 100; ++i) {
+        auto va = a.next();
+        EXPECT_EQ(va, b.next());
+        EXPECT_NE(va, c.next());
+    }
+}
+
+TEST(CounterRngTest, UniformInRange) {
+    CounterRng rng(1, 2);
+    for (int i = 0; i < 1000; ++i) {
+        double u = rng.uniform();
+        EXPECT_GE(u, 0.0);
+        EXPECT_LT(u, 1.0);
+        int k = rng.uniformInt(5);
+        EXPECT_GE(k, 0);
+        EXPECT_LT(k, 5);
+    }
+}
+
+// Test suite for sampling
+class TreeSamplerTest : public ::testing::Test {
+protected:
+    void SetUp() override { makeData(400, X, y); }
+    TreeSampler::FeatureMatrix X;
+    std::vector<int> y;
+};
+
+TEST_F(TreeSamplerTest, PredictionsFollowSignal) {
+    TreeSampler sampler(smallParams());
+    sampler.fit(X, y);
+
+    auto low = sampler.predictProba(std::vector<double>{0.1, 0.5});
+    auto high = sampler.predictProba(std::vector<double>{0.9, 0.5});
+    EXPECT_NEAR(low[0] + low[1], 1.0, 1e-9);
+    EXPECT_GT(low[0], 0.8);
+    EXPECT_GT(high[1], 0.8);
+}
+
+TEST_F(TreeSamplerTest, StoreWeightsCoverAllKeptSamples) {
+    auto params = smallParams();
+    params.thin = 2;
+    TreeSampler sampler(params);
+    sampler.fit(X, y);
+
+    const auto& store = sampler.getSamples();
+    const std::uint64_t kept_per_chain = (params.num_iterations - params.burn_in + 1) / 2;
+    EXPECT_EQ(store.totalWeight(), kept_per_chain * params.num_chains);
+    // Rejected moves reuse the previous tree instead of copying it
+    EXPECT_LT(store.numTrees(), store.totalWeight());
+}
+
+TEST_F(TreeSamplerTest, IncrementalLikelihoodMatchesTrace) {
+    TreeSampler sampler(smallParams());
+    sampler.fit(X, y);
+
+    for (const auto& report : sampler.getChainReports()) {
+        ASSERT_EQ(report.log_likelihood_trace.size(), 300u);
+        EXPECT_GT(report.grow_accepted, 0u);
+        EXPECT_LE(report.grow_accepted, report.grow_proposed);
+        EXPECT_LE(report.prune_accepted, report.prune_proposed);
+        EXPECT_LE(report.change_accepted, report.change_proposed);
+        // Every move scores at most two leaves
+        EXPECT_LE(report.leaf_likelihood_evaluations, 2u * 300u);
+        // Splitting on the signal feature must beat the single-leaf start
+        EXPECT_GT(report.log_likelihood_trace.back(), report.log_likelihood_trace.front());
+    }
+}
+
+TEST_F(TreeSamplerTest, ResultsIndependentOfThreadCount) {
+    auto params = smallParams();
+    params.num_chains = 3;
+    TreeSampler serial(params);
+    serial.fit(X, y);
+
+    params.num_threads = 3;
+    TreeSampler parallel(params);
+    parallel.fit(X, y);
+
+    EXPECT_EQ(serial.getSamples().numTrees(), parallel.getSamples().numTrees());
+    for (const auto& row : {std::vector<double>{0.2, 0.3}, std::vector<double>{0.7, 0.9}}) {
+        EXPECT_EQ(serial.predictProba(row), parallel.predictProba(row));
+    }
+}
+
+TEST_F(TreeSamplerTest, RejectsInvalidParams) {
+    TreeSamplerParams params;
+    params.burn_in = params.num_iterations;
+    EXPECT_THROW(TreeSampler{params}, std::invalid_argument);
+}
+
+// Test suite for compressed leaf storage
+namespace {
+
+double maxAbsError(const SampledTreeStore& a, const SampledTreeStore& b,
+                   const TreeSampler::FeatureMatrix& X) {
+    double err = 0.0;
+    for (const auto& row : X) {
+        const auto pa = a.predictProba(row);
+        const auto pb = b.predictProba(row);
+        for (size_t k = 0; k < pa.size(); ++k) err = std::max(err, std::abs(pa[k] - pb[k]));
+    }
+    return err;
+}
+
+}  // namespace
+
+TEST_F(TreeSamplerTest, CompressedLeavesReportAccuracyLoss) {
+    TreeSampler sampler(smallParams());
+    sampler.fit(X, y, 6);  // Extra classes make leaves longer than the node data
+    const SampledTreeStore& exact = sampler.getSamples();
+
+    std::size_t num_leaves = 0;
+    for (LeafFormat format : {LeafFormat::UInt16, LeafFormat::Float16}) {
+        SampledTreeStore compact = exact;
+        compact.compressLeaves(format);
+        EXPECT_EQ(compact.getLeafFormat(), format);
+        EXPECT_LT(compact.memoryBytes(), exact.memoryBytes());
+        // Consecutive samples share most leaves
+        EXPECT_LT(compact.numLeafEntries(), exact.numLeafEntries());
+        num_leaves = exact.numLeafEntries();
+
+        const double err = maxAbsError(exact, compact, X);
+        const bool is_uint16 = format == LeafFormat::UInt16;
+        RecordProperty(is_uint16 ? "uint16_max_abs_error" : "float16_max_abs_error",
+                       std::to_string(err));
+        EXPECT_LT(err, is_uint16 ? 1e-4 : 1e-3);
+
+        auto probs = compact.predictProba(X[0]);
+        EXPECT_NEAR(std::accumulate(probs.begin(), probs.end(), 0.0), 1.0, 1e-12);
+    }
+    EXPECT_GT(num_leaves, 0u);
+}
+
+TEST_F(TreeSamplerTest, CompressedModelFileShrinksAndRoundTrips) {
+    auto params = smallParams();
+    params.leaf_format = LeafFormat::UInt16;
+    TreeSampler compact(params);
+    compact.fit(X, y, 6);
+    params.leaf_format = LeafFormat::Double;
+    TreeSampler exact(params);
+    exact.fit(X, y, 6);
+
+    std::stringstream exact_file, compact_file;
+    exact.getSamples().save(exact_file);
+    compact.getSamples().save(compact_file);
+    const auto exact_size = exact_file.str().size();
+    const auto compact_size = compact_file.str().size();
+    RecordProperty("double_file_bytes", std::to_string(exact_size));
+    RecordProperty("uint16_file_bytes", std::to_string(compact_size));
+    EXPECT_LT(compact_size, exact_size);
+
+    SampledTreeStore loaded = SampledTreeStore::load(compact_file);
+    EXPECT_EQ(loaded.getLeafFormat(), LeafFormat::UInt16);
+    EXPECT_EQ(loaded.numTrees(), compact.getSamples().numTrees());
+    EXPECT_EQ(loaded.totalWeight(), compact.getSamples().totalWeight());
+    for (const auto& row : X) EXPECT_EQ(loaded.predictProba(row), compact.predictProba(row));
+}
+
+TEST(SampledTreeStoreTest, CompressedStoreRejectsNewTreesAndBadFiles) {
+    SampledTreeStore store;
+    store.clear(2);
+    store.addTree({-1}, {0.0}, {0}, {-1}, {0.25, 0.75});
+    store.compressLeaves(LeafFormat::Float16);
+    // 0.25 and 0.75 are exact in half precision
+    EXPECT_EQ(store.predictProba({0.0}), (std::vector<double>{0.25, 0.75}));
+    EXPECT_THROW(store.addTree({-1}, {0.0}, {0}, {-1}, {0.5, 0.5}), std::logic_error);
+    EXPECT_THROW(store.compressLeaves(LeafFormat::UInt16), std::logic_error);
+
+    std::stringstream bad("not a model");
+    EXPECT_THROW(SampledTreeStore::load(bad), std::runtime_error);
+
+    std::stringstream file;
+    store.save(file);
+    std::string bytes = file.str();
+    std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+    EXPECT_THROW(SampledTreeStore::load(truncated), std::runtime_error);
+}
+
+namespace {
+
+// Save a one-tree store built through the unchecked addTree and load it back
+SampledTreeStore roundTripTree(const std::vector<int>& feature, const std::vector<int>& left,
+                               const std::vector<int>& right, const std::vector<double>& leaf_probs) {
+    SampledTreeStore store;
+    store.clear(2);
+    store.addTree(feature, std::vector<double>(feature.size(), 0.5), left, right, leaf_probs);
+    std::stringstream file;
+    store.save(file);
+    return SampledTreeStore::load(file);
+}
+
+}  // namespace
+
+TEST(SampledTreeStoreTest, LoadRejectsCorruptNodesAndLeaves) {
+    const std::vector<double> two_leaves = {0.25, 0.75, 0.5, 0.5};
+    // Valid: root splits into two leaves
+    EXPECT_NO_THROW(roundTripTree({0, -1, -1}, {1, 0, 1}, {2, -1, -1}, two_leaves));
+
+    // Node 1 is its own left child
+    EXPECT_THROW(roundTripTree({0, 0, -1, -1}, {1, 1, 0, 1}, {3, 2, -1, -1}, two_leaves),
+                 std::runtime_error);
+    // Node 2 points back at node 1, closing a cycle
+    EXPECT_THROW(roundTripTree({0, 0, 0, -1}, {1, 2, 1, 0}, {3, 3, 3, -1}, two_leaves),
+                 std::runtime_error);
+    // Leaf array holds a partial class vector
+    EXPECT_THROW(roundTripTree({0, -1, -1}, {1, 0, 0}, {2, -1, -1}, {0.25, 0.75, 0.5}),
+                 std::runtime_error);
+    // Leaf slot past the end of the leaf array
+    EXPECT_THROW(roundTripTree({0, -1, -1}, {1, 0, 2}, {2, -1, -1}, two_leaves),
+                 std::runtime_error);
+}
+
+TEST(SampledTreeStoreTest, RejectsShortRowsAndEmptyFiles) {
+    SampledTreeStore store;
+    store.clear(2);
+    store.addTree({1, -1, -1}, {0.5, 0.0, 0.0}, {1, 0, 1}, {2, -1, -1}, {0.25, 0.75, 0.5, 0.5});
+    EXPECT_EQ(store.getNumFeaturesUsed(), 2);
+    EXPECT_THROW(store.predictProba({0.0}), std::invalid_argument);
+    EXPECT_EQ(store.predictProba({0.0, 0.0}), (std::vector<double>{0.25, 0.75}));
+
+    SampledTreeStore empty;
+    empty.clear(2);
+    std::stringstream file;
+    empty.save(file);
+    EXPECT_THROW(SampledTreeStore::load(file), std::runtime_error);
+}
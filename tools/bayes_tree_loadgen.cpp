@@ -0,0 +1,140 @@
+// Local load generator for bayes_tree_server.
+//
+//   bayes_tree_loadgen --socket /tmp/bayes_tree.sock --features 8
+//                      [--clients 8] [--requests 10000] [--pipeline 4]
+//                      [--max-failures 0]
+//
+// Each client connection keeps up to --pipeline requests in flight with
+// random feature rows in [0, 1) and records the latency of every answered
+// request. Reports throughput and latency percentiles over all clients.
+// Rejected requests and requests lost to connection errors are counted
+// separately and left out of throughput and latency; the exit status is
+// non-zero if there are more of them than --max-failures.
+#include "bayes_tree/prediction_server.hpp"
+#include "bayes_tree/tree_sampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: bayes_tree_loadgen --socket PATH --features N"
+                 " [--clients N] [--requests N] [--pipeline N] [--max-failures N]\n";
+    return 2;
+}
+
+struct ClientResult {
+    std::vector<double> latencies;  // Microseconds, answered requests only
+    std::uint64_t rejected = 0;     // Answered with an empty probability vector
+    std::uint64_t errors = 0;       // Never answered (connection failed)
+};
+
+void runClient(const std::string& socket_path, int client, int num_features, int num_requests,
+               int pipeline, ClientResult& result) {
+    PredictionClient connection(socket_path);
+    CounterRng rng(2024, static_cast<std::uint64_t>(client));
+    std::vector<Clock::time_point> sent(num_requests);
+    result.latencies.reserve(num_requests);
+
+    std::vector<double> x(num_features);
+    int next = 0;
+    int received = 0;
+    try {
+        while (received < num_requests) {
+            while (next < num_requests && next - received < pipeline) {
+                for (auto& v : x) v = rng.uniform();
+                sent[next] = Clock::now();
+                connection.send(static_cast<std::uint32_t>(next), x);
+                ++next;
+            }
+            const auto response = connection.receive();
+            const auto elapsed = Clock::now() - sent[response.id];
+            ++received;
+            if (response.probs.empty()) {
+                ++result.rejected;
+                continue;
+            }
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        }
+    } catch (...) {
+        result.errors += static_cast<std::uint64_t>(num_requests - received);
+        throw;
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double q) {
+    const auto index = static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string socket_path;
+    int num_features = 0;
+    int num_clients = 8;
+    int num_requests = 10000;
+    int pipeline = 4;
+    int max_failures = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        const int value = std::atoi(argv[i + 1]);
+        if (flag == "--socket") socket_path = argv[i + 1];
+        else if (flag == "--features") num_features = value;
+        else if (flag == "--clients") num_clients = value;
+        else if (flag == "--requests") num_requests = value;
+        else if (flag == "--pipeline") pipeline = value;
+        else if (flag == "--max-failures") max_failures = value;
+        else return usage();
+    }
+    if (argc % 2 == 0 || socket_path.empty() || num_features < 1 || num_clients < 1
+        || num_requests < 1 || pipeline < 1 || max_failures < 0)
+        return usage();
+
+    std::vector<ClientResult> results(num_clients);
+    std::vector<std::thread> clients;
+    const auto start = Clock::now();
+    for (int c = 0; c < num_clients; ++c) {
+        clients.emplace_back([&, c] {
+            try {
+                runClient(socket_path, c, num_features, num_requests, pipeline, results[c]);
+            } catch (const std::exception& e) {
+                std::cerr << "client " << c << ": " << e.what() << '\n';
+                // A failed connect never sent anything
+                if (results[c].errors == 0) results[c].errors = static_cast<std::uint64_t>(num_requests);
+            }
+        });
+    }
+    for (auto& t : clients) t.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    std::uint64_t rejected = 0, errors = 0;
+    for (const auto& r : results) {
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+        rejected += r.rejected;
+        errors += r.errors;
+    }
+    std::sort(all.begin(), all.end());
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "requests:     " << all.size() << " answered, " << rejected << " rejected, "
+              << errors << " errors\n"
+              << "throughput:   " << static_cast<double>(all.size()) / seconds << " req/s\n";
+    if (!all.empty()) {
+        std::cout << "latency (us): p50 " << percentile(all, 0.50) << "  p90 " << percentile(all, 0.90)
+                  << "  p99 " << percentile(all, 0.99) << "  p99.9 " << percentile(all, 0.999)
+                  << "  max " << all.back() << '\n';
+    }
+    return rejected + errors > static_cast<std::uint64_t>(max_failures) ? 1 : 0;
+}
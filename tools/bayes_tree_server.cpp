@@ -0,0 +1,78 @@
+// Prediction server for a saved SampledTreeStore (see SampledTreeStore::save).
+//
+//   bayes_tree_server --model model.bin --socket /tmp/bayes_tree.sock
+//                     [--max-batch 64] [--max-wait-us 200] [--max-outbound-bytes 1048576]
+//
+// SIGHUP reloads the model file in place; SIGINT / SIGTERM stop the server
+// after answering queued requests.
+#include "bayes_tree/prediction_server.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <pthread.h>
+
+namespace {
+
+int usage() {
+    std::cerr << "usage: bayes_tree_server --model PATH --socket PATH"
+                 " [--max-batch N] [--max-wait-us N] [--max-outbound-bytes N]\n";
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string model_path;
+    PredictionServerParams params;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        const std::string value = argv[i + 1];
+        if (flag == "--model") model_path = value;
+        else if (flag == "--socket") params.socket_path = value;
+        else if (flag == "--max-batch") params.max_batch_size = std::atoi(value.c_str());
+        else if (flag == "--max-wait-us") params.max_wait_us = std::atoi(value.c_str());
+        else if (flag == "--max-outbound-bytes") params.max_outbound_bytes = std::strtoull(value.c_str(), nullptr, 10);
+        else return usage();
+    }
+    if (argc % 2 == 0 || model_path.empty() || params.socket_path.empty()) return usage();
+
+    // Handle signals synchronously in this thread; server threads inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        PredictionServer server(model_path, params);
+        server.start();
+        std::cerr << "bayes_tree_server: serving " << model_path << " on " << params.socket_path << '\n';
+
+        for (;;) {
+            int signal = 0;
+            sigwait(&signals, &signal);
+            if (signal != SIGHUP) break;
+            try {
+                server.reloadModel(model_path);
+                std::cerr << "bayes_tree_server: reloaded model, version " << server.getModelVersion() << '\n';
+            } catch (const std::exception& e) {
+                std::cerr << "bayes_tree_server: reload failed, keeping old model: " << e.what() << '\n';
+            }
+        }
+
+        server.stop();
+        const auto stats = server.getStats();
+        std::cerr << "bayes_tree_server: " << stats.requests << " requests in " << stats.batches
+                  << " batches, " << stats.rejected << " rejected, " << stats.reloads << " reloads, "
+                  << stats.slow_clients_closed << " slow clients closed\n";
+    } catch (const std::exception& e) {
+        std::cerr << "bayes_tree_server: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}